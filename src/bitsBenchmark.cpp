@@ -0,0 +1,99 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "bits.h"
+
+
+/*
+ * Bit operation benchmark
+ * Times the operations of bits.h against the implementations they replaced, on random bitboards with as many pieces as
+ * a side usually has (1 to 16 squares set).
+ *
+ * Usage:
+ *  bitsBenchmark [iterations]: Run every benchmark over the given number of passes (default 200)
+ */
+
+
+#define BOARD_COUNT 4096
+
+
+static uint8_t findFirstLog2(const uint64_t pieces) {
+    // Former findFirst in move.h
+    return static_cast<uint8_t>(log2(static_cast<double>(pieces & -pieces)));
+}
+
+static int countFigureLoop(const uint64_t pieces) {
+    // Former countFigure in util.cpp
+    int count = 0;
+    for (int i = 0; i < 64; i++) {
+        if (pieces & ((uint64_t) 1 << i)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+template<typename Operation>
+static void runBenchmark(const char *name, const std::vector<uint64_t> &boards, int iterations, Operation operation) {
+    // Time operation over all boards and print the time per board
+    uint64_t sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (const uint64_t board: boards) {
+            sink += operation(board);
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    double nanoseconds = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    printf("%-28s %8.3f ns/board (checksum %lu)\n", name, nanoseconds / ((double) iterations * (double) boards.size()), sink);
+}
+
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+
+    std::mt19937_64 gen(0);
+    std::uniform_int_distribution<int> countDistribution(1, 16);
+    std::uniform_int_distribution<int> shiftDistribution(0, 63);
+
+    std::vector<uint64_t> boards(BOARD_COUNT);
+    for (uint64_t &board: boards) {
+        board = 0;
+        for (int count = countDistribution(gen); count > 0; count--) {
+            board |= (uint64_t) 1 << shiftDistribution(gen);
+        }
+    }
+
+    runBenchmark("findFirst (log2)", boards, iterations, findFirstLog2);
+    runBenchmark("findFirst", boards, iterations, findFirst);
+
+    runBenchmark("countFigure (loop)", boards, iterations, countFigureLoop);
+    runBenchmark("countFigure", boards, iterations, countFigure);
+
+    // Piece loop as in move generation and evaluation: Visit every set square
+    runBenchmark("piece loop (log2)", boards, iterations, [](uint64_t pieces) {
+        uint64_t sum = 0;
+        while (pieces != 0) {
+            sum += findFirstLog2(pieces);
+            pieces &= (pieces - 1);
+        }
+        return sum;
+    });
+    runBenchmark("piece loop", boards, iterations, [](uint64_t pieces) {
+        uint64_t sum = 0;
+        while (pieces != 0) {
+            sum += findFirst(pieces);
+            pieces = clearFirst(pieces);
+        }
+        return sum;
+    });
+
+    return 0;
+}
@@ -11,26 +11,52 @@
  * 1x Black Positions (8 bytes)
  * 6x Figure Positions (6x8 bytes)
  * => Total 64 bytes (8 * field)
+ * In addition a mailbox holds the piece on every square (64 bytes), so a single load tells what stands on a square.
  */
 
+
+enum class piece {
+    king,
+    queen,
+    rook,
+    bishop,
+    knight,
+    pawn,
+    none
+};
+
+// Mailbox entries: White pieces in the order of piece, black pieces MAILBOX_BLACK later, MAILBOX_EMPTY for none
+#define MAILBOX_BLACK 6
+#define MAILBOX_EMPTY 12
+
+inline uint8_t mailboxEntry(bool color, piece p) {
+    return p == piece::none ? MAILBOX_EMPTY : (uint8_t) p + (color ? MAILBOX_BLACK : 0);
+}
+
+inline piece mailboxPiece(uint8_t entry) {
+    return entry == MAILBOX_EMPTY ? piece::none : (piece) (entry % MAILBOX_BLACK);
+}
+
 typedef struct board {
-    const field whiteKing;
-    const field whiteQueen;
-    const field whiteRook;
-    const field whiteBishop;
-    const field whiteKnight;
-    const field whitePawn;
-
-    const field blackKing;
-    const field blackQueen;
-    const field blackRook;
-    const field blackBishop;
-    const field blackKnight;
-    const field blackPawn;
+    field whiteKing;
+    field whiteQueen;
+    field whiteRook;
+    field whiteBishop;
+    field whiteKnight;
+    field whitePawn;
+
+    field blackKing;
+    field blackQueen;
+    field blackRook;
+    field blackBishop;
+    field blackKnight;
+    field blackPawn;
 
     field white;
     field black;
-    const field occupied;
+    field occupied;
+
+    uint8_t pieceOn[64];  // Mailbox entry of every square, kept in sync with the bitboards by move making
 
     board(
             field wk, field wq, field wr, field wb, field wn, field wp,
@@ -39,7 +65,17 @@ typedef struct board {
             blackKing(bk), blackQueen(bq), blackRook(br), blackBishop(bb), blackKnight(bn), blackPawn(bp),
             white(wk | wq | wr | wb | wn | wp),
             black(bk | bq | br | bb | bn | bp),
-            occupied(white | black) {}
+            occupied(white | black) {
+        const field pieces[12] = {wk, wq, wr, wb, wn, wp, bk, bq, br, bb, bn, bp};
+        for (int shift = 0; shift < 64; shift++) {
+            pieceOn[shift] = MAILBOX_EMPTY;
+            for (uint8_t entry = 0; entry < 12; entry++) {
+                if ((pieces[entry] >> shift) & 1) {
+                    pieceOn[shift] = entry;
+                }
+            }
+        }
+    }
 
 //    board(const board &other) :
 //            whiteKing(other.whiteKing), whiteQueen(other.whiteQueen), whiteRook(other.whiteRook), whiteBishop(other.whiteBishop), whiteKnight(other.whiteKnight), whitePawn(other.whitePawn),
@@ -55,17 +91,6 @@ typedef struct board {
 } t_board;
 
 
-enum class piece {
-    king,
-    queen,
-    rook,
-    bishop,
-    knight,
-    pawn,
-    none
-};
-
-
 #define UNICODE_WHITE_KING L'\x2654'
 #define UNICODE_WHITE_QUEEN L'\x2655'
 #define UNICODE_WHITE_ROOK L'\x2656'
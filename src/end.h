@@ -14,6 +14,15 @@ typedef enum {
 } winner_t;
 
 
+template<bool color>
+inline static bool hasMoves(t_gameState *state, const t_positionInfo &info) {
+    // Only the existence of moves matters, so they are counted instead of listed
+    t_moveCountVisitor moves;
+    generate_moves<color>(*state, info, moves);
+    return moves.count != 0;
+}
+
+
 inline static bool isCheckmate(bool color, t_gameState *state) {
     /* Function to check whether the now moving party is checkmate
     * Arguments:
@@ -21,21 +30,13 @@ inline static bool isCheckmate(bool color, t_gameState *state) {
     *  bool color: the next moving color with "false" for white and "true" for black
     */
 
-    t_board board = state->board;
-
     if (color) {
-        bool kingThreatened = board.blackKing & getThreatenedBlack(board);
-        if (kingThreatened) {
-            return generate_moves<true>(*state).empty();  // King is threatened and there are no moves
-        }
+        t_positionInfo info = getPositionInfo<true>(state->board);
+        return info.checkers != 0 && !hasMoves<true>(state, info);  // King is threatened and there are no moves
     } else {
-        bool kingThreatened = board.whiteKing & getThreatenedWhite(board);
-        if (kingThreatened) {
-            return generate_moves<false>(*state).empty();  // King is threatened and there are no moves
-        }
+        t_positionInfo info = getPositionInfo<false>(state->board);
+        return info.checkers != 0 && !hasMoves<false>(state, info);  // King is threatened and there are no moves
     }
-
-    return false;
 }
 
 inline static bool isStalemate(bool color, t_gameState *state) {
@@ -46,9 +47,11 @@ inline static bool isStalemate(bool color, t_gameState *state) {
     */
 
     if (color) {
-        return generate_moves<true>(*state).empty();
+        t_positionInfo info = getPositionInfo<true>(state->board);
+        return info.checkers == 0 && !hasMoves<true>(state, info);
     } else {
-        return generate_moves<false>(*state).empty();
+        t_positionInfo info = getPositionInfo<false>(state->board);
+        return info.checkers == 0 && !hasMoves<false>(state, info);
     }
 }
 
@@ -84,20 +87,21 @@ inline static winner_t checkEndLimited(bool color, t_gameState *state) {
 }
 
 
-inline static winner_t checkEndNoMoves(bool color, t_gameState *state) {
+inline static winner_t checkEndNoMoves(bool color, const t_positionInfo &info) {
     // Check for game end while assuming that no more moves were found
-    // NOTE: color = side that last moved
-    t_board board = state->board;
-    if (!color) {
-        if (getThreatenedWhite(board) & board.blackKing) {
-            return WHITE;
-        }
-        return DRAW;
+    // NOTE: color = side that last moved, info = position info of the side that can't move
+    if (info.checkers != 0) {
+        return color ? BLACK : WHITE;
+    }
+    return DRAW;
+}
+
+inline static winner_t checkEndNoMoves(bool color, t_gameState *state) {
+    // See above, for callers without the position info at hand
+    if (color) {
+        return checkEndNoMoves(color, getPositionInfo<false>(state->board));
     } else {
-        if (getThreatenedBlack(board) & board.whiteKing) {
-            return BLACK;
-        }
-        return DRAW;
+        return checkEndNoMoves(color, getPositionInfo<true>(state->board));
     }
 }
 
@@ -113,10 +117,19 @@ inline static winner_t checkEnd(bool color, t_gameState *state) {
 
     if (isKingOfTheHill(color, state->board)) {
         return color ? BLACK : WHITE;
-    } else if (isCheckmate(!color, state)) {
-        return color ? BLACK : WHITE;
-    } else if (isStalemate(color, state)) {
-        return DRAW;
+    }
+
+    // Checkmate and stalemate both leave the now moving party without moves, the position info tells them apart
+    if (color) {
+        t_positionInfo info = getPositionInfo<false>(state->board);
+        if (!hasMoves<false>(state, info)) {
+            return checkEndNoMoves(color, info);
+        }
+    } else {
+        t_positionInfo info = getPositionInfo<true>(state->board);
+        if (!hasMoves<true>(state, info)) {
+            return checkEndNoMoves(color, info);
+        }
     }
 
     return NOTOVER;
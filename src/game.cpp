@@ -23,6 +23,12 @@ void playAlphaBeta(int maxRounds, uint64_t gameTime) {
     t_game game = t_game(gameTime);
     printBoard(game.state->board);
 
+    // One table for both colors, kept from move to move for the whole game
+    TranspositionTable table(TT_DEFAULT_SIZE_MB);
+    const t_largeAllocation &tableMemory = table.getMemory();
+    printf("Transposition table: %zu MB on %s, %zu MB backed by huge pages\n", tableMemory.size >> 20,
+           pageKindName(tableMemory.pages), hugePageBytes(tableMemory) >> 20);
+
 
 //    std::vector<t_gameState> moves = generate_moves<true>(*game.state);
 //
@@ -34,36 +40,36 @@ void playAlphaBeta(int maxRounds, uint64_t gameTime) {
 //    }
 
     // Generate next move
-    t_gameState *nextMove = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
+    t_move nextMove;
     while (!game.isOver && (game.moveCounter/2 + 1) <= maxRounds) {
         std::chrono::nanoseconds diff;
         if (game.turn) {
             // Black's turn
             std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-            std::pair<gameState, float> result = getMoveAlphaBeta<true>(&game);
+            std::pair<t_move, float> result = getMoveAlphaBeta<true>(&game, &table);
             std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
             diff = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 
-            memcpy(nextMove, &result.first, sizeof(t_gameState));
+            nextMove = result.first;
 
             printf("Found move ");
-            printMove(*nextMove, ' ');
+            printMove(nextMove, ' ');
             printf("with score %f for black [%fs]\n", result.second, (double )diff.count() / 1e9);
         } else {
             // White's turn
             std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-            std::pair<gameState, float> result = getMoveAlphaBeta<false>(&game);
+            std::pair<t_move, float> result = getMoveAlphaBeta<false>(&game, &table);
             std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
             diff = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 
-            memcpy(nextMove, &result.first, sizeof(t_gameState));
+            nextMove = result.first;
 
             printf("Found move ");
-            printMove(*nextMove, ' ');
+            printMove(nextMove, ' ');
             printf("with score %f [%fs]\n", result.second, (double )diff.count() / 1e9);
         }
 
-        game.commitMoveTimed(*nextMove);
+        game.commitMoveTimed(nextMove);
 
         // Print game state information
         printf("Current board state (Score: %.4f, Round: %d, ", evaluate(&game), game.moveCounter/2 + 1);
@@ -75,14 +81,14 @@ void playAlphaBeta(int maxRounds, uint64_t gameTime) {
         }
 
         // Check and announce checks
-        bool threatened;
+        uint64_t checkers;
         if (game.turn) {
-            threatened = game.board().blackKing & getThreatenedBlack(game.board());
+            checkers = getPositionInfo<true>(game.board()).checkers;
         } else {
-            threatened = game.board().whiteKing & getThreatenedWhite(game.board());
+            checkers = getPositionInfo<false>(game.board()).checkers;
         }
 
-        if (threatened) {
+        if (checkers != 0) {
             printf("CHECK\n");
         }
 
@@ -91,8 +97,6 @@ void playAlphaBeta(int maxRounds, uint64_t gameTime) {
 
 
     }
-    free(nextMove);
-
     printf("Game over!\n");
     printf("Game is over: %d\n", game.isOver);
     printf("White won: %d\n", game.whiteWon);
@@ -102,7 +106,6 @@ void playAlphaBeta(int maxRounds, uint64_t gameTime) {
 
     // Free memory
     delete game.positionHistory;
-    free(game.random);
     free(game.state);
 }
 
@@ -129,28 +132,28 @@ void playMonteCarlo(int maxRounds, uint64_t gameTime) {
 //    }
 
     // Generate next move
-    t_gameState *nextMove = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
+    t_move nextMove;
     while (!game.isOver && (game.moveCounter/2 + 1) <= maxRounds) {
         std::chrono::nanoseconds diff;
 
         // Black's turn
         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-        std::pair<gameState, MonteCarloTree *> result = getMoveMonteCarlo(currentTree);
+        std::pair<t_move, MonteCarloTree *> result = getMoveMonteCarlo(currentTree);
         std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
         diff = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 
-        memcpy(nextMove, &result.first, sizeof(t_gameState));
+        nextMove = result.first;
         currentTree = result.second;
 
         printf("Found move ");
-        printMove(*nextMove, ' ');
+        printMove(nextMove, ' ');
         if (game.turn) {
             printf("for black [%fs]\n", (double )diff.count() / 1e9);
         } else {
             printf("for white [%fs]\n", (double )diff.count() / 1e9);
         }
 
-        game.commitMoveTimed(*nextMove);
+        game.commitMoveTimed(nextMove);
 
         // Print game state information
         printf("Current board state (Score: %.4f, Round: %d, ", evaluate(&game), game.moveCounter/2 + 1);
@@ -162,14 +165,14 @@ void playMonteCarlo(int maxRounds, uint64_t gameTime) {
         }
 
         // Check and announce checks
-        bool threatened;
+        uint64_t checkers;
         if (game.turn) {
-            threatened = game.board().blackKing & getThreatenedBlack(game.board());
+            checkers = getPositionInfo<true>(game.board()).checkers;
         } else {
-            threatened = game.board().whiteKing & getThreatenedWhite(game.board());
+            checkers = getPositionInfo<false>(game.board()).checkers;
         }
 
-        if (threatened) {
+        if (checkers != 0) {
             printf("CHECK\n");
         }
 
@@ -178,8 +181,6 @@ void playMonteCarlo(int maxRounds, uint64_t gameTime) {
 
 
     }
-    free(nextMove);
-
     printf("Game over!\n");
     printf("Game is over: %d\n", game.isOver);
     printf("White won: %d\n", game.whiteWon);
@@ -189,6 +190,5 @@ void playMonteCarlo(int maxRounds, uint64_t gameTime) {
 
     // Free memory
     delete game.positionHistory;
-    free(game.random);
     free(game.state);
 }
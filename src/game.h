@@ -3,7 +3,7 @@
 
 
 #include <map>
-#include <stack>
+#include <vector>
 #include <string>
 #include <cstring>
 #include <chrono>
@@ -13,19 +13,22 @@
 #include "transpositionTable.h"
 #include "hash.h"
 #include "end.h"
+#include "movePicker.h"
+
+
+// Initial capacity of the undo stack, enough for a full game plus search depth without reallocating
+#define UNDO_STACK_RESERVE 512
 
 
 typedef struct game {
     t_gameState *state;
-    std::stack<t_gameState> stateStack;
+    std::vector<t_undo> undoStack;  // One undo record per committed move, see revertMove
 
-    uint64_t *random;
     std::map<uint64_t, int> *positionHistory = nullptr;
 
     bool turn;
 
     double gameTime;
-    short averageMoveCount = 20;
 
     double whiteMoveTime;
     std::chrono::steady_clock::time_point whiteLastMoveTime;
@@ -42,15 +45,14 @@ typedef struct game {
 
     short moveCounter;
 
-    TranspositionTable tableWhite;
-    TranspositionTable tableBlack;
+    t_killerTable killers = {};
 
     game(game const &other) {
         state = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
         memcpy(state, other.state, sizeof(t_gameState));
 
-        stateStack = std::stack<t_gameState>(other.stateStack);
-        random = other.random;
+        undoStack = std::vector<t_undo>(other.undoStack);
+        undoStack.reserve(UNDO_STACK_RESERVE);
         turn = other.turn;
 
         gameTime = other.gameTime;
@@ -64,9 +66,6 @@ typedef struct game {
         blackWon = other.blackWon;
 
         moveCounter = other.moveCounter;
-
-        tableWhite = TranspositionTable(other.tableWhite);
-        tableBlack = TranspositionTable(other.tableBlack);
     }
 
     explicit game(uint64_t time) {
@@ -77,11 +76,12 @@ typedef struct game {
         t_gameState *startStateMem = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
         memcpy(startStateMem, &startState, sizeof(t_gameState));
 
-        stateStack = std::stack<t_gameState>();
+        undoStack = std::vector<t_undo>();
+        undoStack.reserve(UNDO_STACK_RESERVE);
         state = startStateMem;
 
-        random = init_hash();
         turn = false;
+        state->hash = hash(state, turn);
 
         gameTime = (double )time;
         whiteMoveTime = (double )time;
@@ -94,9 +94,6 @@ typedef struct game {
         blackWon = false;
 
         moveCounter = 0;
-
-        tableWhite = TranspositionTable();
-        tableBlack = TranspositionTable();
     }
     game(char *startFen, bool color, uint64_t time) {
         // Game constructor from FEN and side to move
@@ -106,11 +103,12 @@ typedef struct game {
         t_gameState *startStateMem = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
         memcpy(startStateMem, &startState, sizeof(t_gameState));
 
-        stateStack = std::stack<t_gameState>();
+        undoStack = std::vector<t_undo>();
+        undoStack.reserve(UNDO_STACK_RESERVE);
         state = startStateMem;
 
-        random = init_hash();
         turn = color;
+        state->hash = hash(state, turn);
 
         gameTime = (double )time;
         whiteMoveTime = (double )time;
@@ -123,9 +121,6 @@ typedef struct game {
         blackWon = false;
 
         moveCounter = 0;
-
-        tableWhite = TranspositionTable();
-        tableBlack = TranspositionTable();
     }
     game(char *startFen, bool color, uint8_t castleCode, uint64_t time) {
         // Game constructor from FEN, side to move and castling code
@@ -143,11 +138,12 @@ typedef struct game {
         t_gameState *startStateMem = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
         memcpy(startStateMem, &startState, sizeof(t_gameState));
 
-        stateStack = std::stack<t_gameState>();
+        undoStack = std::vector<t_undo>();
+        undoStack.reserve(UNDO_STACK_RESERVE);
         state = startStateMem;
 
-        random = init_hash();
         turn = color;
+        state->hash = hash(state, turn);
 
         gameTime = (double )time;
         whiteMoveTime = (double )time;
@@ -160,9 +156,6 @@ typedef struct game {
         blackWon = false;
 
         moveCounter = 0;
-
-        tableWhite = TranspositionTable();
-        tableBlack = TranspositionTable();
     }
     game(char *startFen, bool color, uint8_t castleCode, uint8_t ep, uint64_t time) {
         // Game constructor from FEN, side to move and castling code
@@ -180,11 +173,12 @@ typedef struct game {
         t_gameState *startStateMem = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
         memcpy(startStateMem, &startState, sizeof(t_gameState));
 
-        stateStack = std::stack<t_gameState>();
+        undoStack = std::vector<t_undo>();
+        undoStack.reserve(UNDO_STACK_RESERVE);
         state = startStateMem;
 
-        random = init_hash();
         turn = color;
+        state->hash = hash(state, turn);
 
         gameTime = (double )time;
         whiteMoveTime = (double )time;
@@ -197,13 +191,6 @@ typedef struct game {
         blackWon = false;
 
         moveCounter = 0;
-
-        tableWhite = TranspositionTable();
-        tableBlack = TranspositionTable();
-    }
-
-    void updateAverageMoves(short moveCount) {
-        averageMoveCount = (short )((3 * averageMoveCount + moveCount) / 4);
     }
 
     void positionTracking() {
@@ -211,7 +198,7 @@ typedef struct game {
         * Arguments:
         *  t_gameOld *gameOld: Pointer to the gameOld representing the state of the gameOld
         */
-        uint64_t boardHash = hash(random, state);
+        uint64_t boardHash = state->hash;
         std::map<uint64_t, int> &map = *positionHistory;
 
         if (positionHistory == nullptr) {
@@ -230,7 +217,7 @@ typedef struct game {
     }
 
     void positionTrackingUndo() const {
-        uint64_t boardHash = hash(random, state);
+        uint64_t boardHash = state->hash;
         std::map<uint64_t, int> &map = *positionHistory;
 
         if (positionHistory != nullptr) {
@@ -245,7 +232,7 @@ typedef struct game {
     }
 
     int positionRepetitions() const {
-        uint64_t boardHash = hash(random, state);
+        uint64_t boardHash = state->hash;
         std::map<uint64_t, int> &map = *positionHistory;
 
         if (positionHistory != nullptr) {
@@ -257,10 +244,23 @@ typedef struct game {
         return 0;
     }
 
-    void commitMove(t_gameState move) {
-        stateStack.push(*state);
+    void commitMove(t_move move, const TranspositionTable *table = nullptr) {
+        /* Play the move in place, the undo record keeps what is needed to take it back
+         * Arguments:
+         *  move: Move to play
+         *  table: Table the new position is going to be looked up in, if any. Its bucket is prefetched as soon as the
+         *         hash is known, so loading it overlaps with the rest of the move
+         */
+        t_undo &undo = undoStack.emplace_back();
+        if (turn) {
+            makeMove<true>(*state, move, &undo);
+        } else {
+            makeMove<false>(*state, move, &undo);
+        }
 
-        memcpy(state, &move, sizeof(t_gameState));
+        if (table != nullptr) {
+            table->prefetch(state->hash);
+        }
 
         turn = !turn;
         moveCounter++;
@@ -283,7 +283,7 @@ typedef struct game {
         // TODO: Stuff with move time?
     }
 
-    void commitMoveTimed(t_gameState move) {
+    void commitMoveTimed(t_move move) {
         std::chrono::time_point currentTime = std::chrono::steady_clock::now();
         if (turn) {
             // Black is moving
@@ -329,9 +329,15 @@ typedef struct game {
     void revertMove() {
         positionTrackingUndo();
 
-        memcpy(state, &stateStack.top(), sizeof(t_gameState));  // Reset game state to last state
+        // Take back the last move, which was played by the opposing color
+        const t_undo &undo = undoStack.back();
+        if (turn) {
+            unmakeMove<false>(*state, undo);
+        } else {
+            unmakeMove<true>(*state, undo);
+        }
 
-        stateStack.pop();  // Remove the (now) current move from the stack
+        undoStack.pop_back();  // Remove the (now) current move from the stack
 
         turn = !turn;
         moveCounter--;
@@ -341,7 +347,7 @@ typedef struct game {
         blackWon = false;
     }
 
-    t_board board() const {
+    const t_board &board() const {
         return state->board;
     }
 
@@ -2,6 +2,7 @@
 #define KINGOFTHEHILL_KI_HASH_H
 
 #include <cstdint>
+#include "hashKeys.h"
 #include "move.h"
 
 #define OFFSET 6
@@ -14,8 +15,8 @@
 #define PAWN 5
 
 
-uint64_t hash(const uint64_t* random, t_gameState *state);
-uint64_t* init_hash();
-int getFigureOnPos(t_board board, int pos);
+uint64_t hash(t_gameState *state, bool color);
+int getFigureOnPos(const t_board &board, int pos);
+
 
 #endif //KINGOFTHEHILL_KI_HASH_H
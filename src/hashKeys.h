@@ -0,0 +1,58 @@
+#ifndef KINGOFTHEHILL_KI_HASHKEYS_H
+#define KINGOFTHEHILL_KI_HASHKEYS_H
+
+#include <array>
+#include <cstdint>
+
+
+/*
+ * Hash keys
+ * One random key per piece and square, per combination of castling rights (indexed by the castling code of the t_game
+ * constructor), per en passant file and one for black to move. Every field of the position has keys of its own, so
+ * positions differing only in castling rights, en passant or the side to move don't collide.
+ *
+ * The keys are generated at compile time by splitmix64 from a fixed seed and shared by all games, so a position hashes
+ * to the same value in every game, run and build.
+ */
+
+#define HASH_PIECE_KEYS 0
+#define HASH_CASTLE_KEYS (HASH_PIECE_KEYS + 64 * 12)
+#define HASH_ENPASSANT_KEYS (HASH_CASTLE_KEYS + 16)
+#define HASH_SIDE_KEY (HASH_ENPASSANT_KEYS + 8)
+#define HASH_KEY_COUNT (HASH_SIDE_KEY + 1)
+
+#define HASH_SEED 0x4b6f7448696c6c00ULL
+
+
+inline constexpr std::array<uint64_t, HASH_KEY_COUNT> hashKeys = [] {
+    std::array<uint64_t, HASH_KEY_COUNT> keys{};
+    uint64_t state = HASH_SEED;
+    for (uint64_t &key: keys) {
+        // splitmix64
+        state += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        key = z ^ (z >> 31);
+    }
+    return keys;
+}();
+
+
+inline uint64_t hashStats(bool wCastleShort, bool wCastleLong, bool bCastleShort, bool bCastleLong, uint8_t enpassant) {
+    // Keys of the castling rights and the en passant file
+    uint8_t castleCode = (uint8_t) (wCastleShort | (wCastleLong << 1) | (bCastleShort << 2) | (bCastleLong << 3));
+
+    uint64_t stats = hashKeys[HASH_CASTLE_KEYS + castleCode];
+    if (enpassant != 0) {
+        stats ^= hashKeys[HASH_ENPASSANT_KEYS + enpassant - 1];
+    }
+    return stats;
+}
+
+inline uint64_t hashPiece(uint8_t shift, uint8_t entry) {
+    // Key of the piece with the given mailbox entry standing on the given square
+    return hashKeys[HASH_PIECE_KEYS + shift * 12 + entry];
+}
+
+#endif //KINGOFTHEHILL_KI_HASHKEYS_H
@@ -2,6 +2,8 @@
 #define KINGOFTHEHILL_KI_HIKARU_H
 
 
+#include <cmath>
+#include <chrono>
 #include <cstdint>
 #include <ctime>
 #include <thread>
@@ -12,6 +14,7 @@
 #include "pieceSquareTable.h"
 #include "end.h"
 #include "scoredMove.h"
+#include "transpositionTable.h"
 #include "monteCarloTree.h"
 
 #define QUEEN_VALUE 9
@@ -21,53 +24,98 @@
 #define PAWN_VALUE 1
 
 
-#define LAYER_SIZE_CORRECTION 0.7
+// Time management, see alphaBetaHead. Times are shares of the time per move: Remaining time / remaining moves
+#define SEARCH_SOFT_LIMIT 0.6  // No iteration is started after this share
+#define SEARCH_HARD_LIMIT 2.5  // The running iteration is abandoned after this share
+#define SEARCH_HARD_MAX_SHARE 0.25  // ... but never later than this share of the whole remaining time
+#define SEARCH_MIN_MOVES_REMAINING 10  // Time is split over at least this many moves
+#define SEARCH_MIN_BRANCHING 2.0  // Least growth in time assumed from one iteration to the next
+#define SEARCH_MAX_BRANCHING 16.0  // Most growth assumed, iterations too short to time reliably may suggest more
+#define SEARCH_CLOCK_INTERVAL 256  // Inner nodes searched between two looks at the clock
+
+
+typedef struct searchLimits {
+    std::chrono::steady_clock::time_point softDeadline = std::chrono::steady_clock::time_point::max();
+    std::chrono::steady_clock::time_point hardDeadline = std::chrono::steady_clock::time_point::max();
+    uint64_t nodes = 0;
+    bool stopped = false;
+    int completedDepth = 0;  // Depth of the last iteration searched to the end
+
+    bool stop() {
+        // Whether the search has to stop, the clock is only read every SEARCH_CLOCK_INTERVAL nodes
+        if (!stopped && ++nodes % SEARCH_CLOCK_INTERVAL == 0) {
+            stopped = std::chrono::steady_clock::now() >= hardDeadline;
+        }
+        return stopped;
+    }
+} t_searchLimits;
+
+static inline std::chrono::steady_clock::duration searchDuration(double seconds) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
 
 
 //calculate score fore moves from transposition table from vision*score
-static inline scoredMove *scoreMove(t_gameState gameState, TranspositionTable *t, t_game *game) {
+template<bool color>
+static inline scoredMove scoreMove(t_move mov, TranspositionTable *t, t_game *game) {
+    t_gameState nextState = *game->state;
+    t_undo undo;
+    makeMove<color>(nextState, mov, &undo);
+
     float score;
-    if (t->_hashTable->find(hash(game->random, &gameState)) != t->_hashTable->end()) {
-        score = t->_hashTable->find(hash(game->random, &gameState))->second.getScore() *
-                (float) t->_hashTable->find(hash(game->random, &gameState))->second.getVision();
+    TableEntry entry;
+    if (t->getEntry(nextState.hash, &entry)) {
+        score = entry.getScore() * (float) entry.getVision();
     } else {
         score = 0;
     }
-    return new scoredMove(score, &gameState);
+    return {score, mov};
 }
 
-// calculates the time left finding a move
-static uint64_t timeLeft(uint64_t timePerMove, time_t startMoveTime) {
-    time_t currentTime = time(nullptr);
-    return currentTime - timePerMove - startMoveTime;
-}
+template<bool color>
+static inline void sortMoves(MoveList *moves, TranspositionTable *t, t_game *game) {
+    // Apply move ordering by scoring moves as vision*score, best move for the moving color first
+    scoredMove sortedMoves[MAX_MOVES];
+    for (int i = 0; i < moves->size(); i++) {
+        sortedMoves[i] = scoreMove<color>((*moves)[i], t, game);
+    }
 
-#include <algorithm>
+    // Insertion sort: Stable and allocation free, which is all that is needed for lists of this size
+    for (int i = 1; i < moves->size(); i++) {
+        scoredMove current = sortedMoves[i];
 
-void printMoveStack(t_game *game, int depth) {
-    std::stack<t_gameState> moveStack = game->stateStack;
+        int j = i - 1;
+        while (j >= 0 && (color ? current < sortedMoves[j] : current > sortedMoves[j])) {
+            sortedMoves[j + 1] = sortedMoves[j];
+            j--;
+        }
+        sortedMoves[j + 1] = current;
+    }
 
-    std::vector<t_gameState> debugVector = std::vector<t_gameState>();
-    while (!moveStack.empty() && debugVector.size() < depth - 1) {
-        t_gameState t = moveStack.top();
-        debugVector.push_back(t);
-        moveStack.pop();
+    for (int i = 0; i < moves->size(); i++) {
+        (*moves)[i] = sortedMoves[i]._move;
     }
+}
 
-    // stack, read from top down, is reversed relative to its creation (from bot to top)
-    for (int i = (int) debugVector.size() - 1; i >= 0; i--) {
-        t_gameState currentState = debugVector.at(i);
+#include <algorithm>
 
-        printMove(currentState, '\t');
-        game->stateStack.push(currentState);
+inline void printMoveStack(t_game *game, int depth) {
+    // Each undo record holds the move that led to the state it was taken from, the current move is in the state
+    int first = max((int) game->undoStack.size() - (depth - 1), 0);
+    for (int i = first; i < (int) game->undoStack.size(); i++) {
+        printMove(game->undoStack.at(i).move, '\t');
     }
 
-    printMove(*game->state, '\t');
+    printMove(game->state->move, '\t');
 }
 
 
 inline float evaluate(t_game *game) {
-    // Simple approach to evaluating positions by taking a look at the available material
+    /* Simple approach to evaluating positions by taking a look at the available material
+     * Deliberately without attack or pin terms: Leaves are evaluated before any t_positionInfo exists for them (only
+     * MovePicker computes one, for positions it generates moves for), so reading one here would bring back an attack
+     * generation per leaf. Mate and stalemate are decided from the info before this is called, see game->isOver.
+     */
     if (game->isOver) {
         if (game->whiteWon) {
             // White won -> Return max value minus move counter to prioritize faster wins
@@ -112,7 +160,7 @@ inline float evaluate(t_game *game) {
     while (wQueens != 0) {
         short shift = findFirst(wQueens);
         score += QUEEN_VALUE + pst_queen_white[shift];
-        wQueens &= (wQueens - 1);
+        wQueens = clearFirst(wQueens);
     }
 
     // Rooks
@@ -120,7 +168,7 @@ inline float evaluate(t_game *game) {
     while (wRooks != 0) {
         short shift = findFirst(wRooks);
         score += ROOK_VALUE + pst_rook_white[shift];
-        wRooks &= (wRooks - 1);
+        wRooks = clearFirst(wRooks);
     }
 
     // Bishops
@@ -128,7 +176,7 @@ inline float evaluate(t_game *game) {
     while (wBishops != 0) {
         short shift = findFirst(wBishops);
         score += BISHOP_VALUE + pst_bishop_white[shift];
-        wBishops &= (wBishops - 1);
+        wBishops = clearFirst(wBishops);
     }
 
     // Knight
@@ -136,7 +184,7 @@ inline float evaluate(t_game *game) {
     while (wKnights != 0) {
         short shift = findFirst(wKnights);
         score += KNIGHT_VALUE + pst_knight_white[shift];
-        wKnights &= (wKnights - 1);
+        wKnights = clearFirst(wKnights);
     }
 
     // Pawns
@@ -144,7 +192,7 @@ inline float evaluate(t_game *game) {
     while (wPawns != 0) {
         short shift = findFirst(wPawns);
         score += PAWN_VALUE + pst_pawn_white[shift];
-        wPawns &= (wPawns - 1);
+        wPawns = clearFirst(wPawns);
     }
 
 
@@ -161,7 +209,7 @@ inline float evaluate(t_game *game) {
     while (bQueens != 0) {
         short shift = findFirst(bQueens);
         score -= QUEEN_VALUE + pst_queen_black[shift];
-        bQueens &= (bQueens - 1);
+        bQueens = clearFirst(bQueens);
     }
 
     // Rooks
@@ -169,7 +217,7 @@ inline float evaluate(t_game *game) {
     while (bRooks != 0) {
         short shift = findFirst(bRooks);
         score -= ROOK_VALUE + pst_rook_black[shift];
-        bRooks &= (bRooks - 1);
+        bRooks = clearFirst(bRooks);
     }
 
     // Bishops
@@ -177,7 +225,7 @@ inline float evaluate(t_game *game) {
     while (bBishops != 0) {
         short shift = findFirst(bBishops);
         score -= BISHOP_VALUE + pst_bishop_black[shift];
-        bBishops &= (bBishops - 1);
+        bBishops = clearFirst(bBishops);
     }
 
     // Knight
@@ -185,7 +233,7 @@ inline float evaluate(t_game *game) {
     while (bKnights != 0) {
         short shift = findFirst(bKnights);
         score -= KNIGHT_VALUE + pst_knight_black[shift];
-        bKnights &= (bKnights - 1);
+        bKnights = clearFirst(bKnights);
     }
 
     // Pawns
@@ -193,7 +241,7 @@ inline float evaluate(t_game *game) {
     while (bPawns != 0) {
         short shift = findFirst(bPawns);
         score -= PAWN_VALUE + pst_pawn_black[shift];
-        bPawns &= (bPawns - 1);
+        bPawns = clearFirst(bPawns);
     }
 
 
@@ -205,11 +253,12 @@ inline float evaluate(t_game *game) {
 
 
 template<bool color>
-static inline t_gameState getMoveRandom(t_game *game) {
-    std::vector<t_gameState> possibleMoves = generate_moves<color>(*game->state);
+static inline t_move getMoveRandom(t_game *game) {
+    MoveList possibleMoves;
+    generate_moves<color>(*game->state, &possibleMoves);
 
     if (possibleMoves.empty()) {
-        return {game->board(), t_move()};
+        return t_move();
     }
 
     // Generate random number within bounds of possible moves list and return the corresponding move
@@ -217,40 +266,84 @@ static inline t_gameState getMoveRandom(t_game *game) {
     return possibleMoves.at(randomMoveIndex);
 }
 
+static inline bool probeCutoff(const TableEntry &entry, int depth, float *alpha, float *beta) {
+    /* Use a stored result searched at least as deep as depth: An exact score is returned right away, a bound narrows the
+     * window (alpha, beta). Returns true if the stored score decides the position, which is the case once the window
+     * is empty.
+     */
+    if (entry.getVision() < depth) {
+        return false;
+    }
+
+    switch (entry.getBound()) {
+        case TT_BOUND_EXACT:
+            return true;
+        case TT_BOUND_LOWER:
+            *alpha = max(*alpha, entry.getScore());
+            break;
+        case TT_BOUND_UPPER:
+            *beta = min(*beta, entry.getScore());
+            break;
+        default:
+            return false;
+    }
+    return *alpha >= *beta;
+}
+
 template<bool color>
-static inline std::tuple<float, short> alphaBeta(int depth, float alpha, float beta, t_game *game) {
+static inline void storeResult(TranspositionTable *t, uint64_t hash, t_move bestMove, float score, int depth, float alpha, float beta) {
+    // Store the result of searching depth plies within the window (alpha, beta) the search was started with
+    uint8_t bound = TT_BOUND_EXACT;
+    if (score <= alpha) {
+        bound = TT_BOUND_UPPER;
+    } else if (score >= beta) {
+        bound = TT_BOUND_LOWER;
+    }
 
-    if (depth <= 0 || game->isOver) {
-        return {evaluate(game), 0};
+    // If no move reached the window for the moving color, none of them is known to be best
+    if (bound == (color ? TT_BOUND_LOWER : TT_BOUND_UPPER)) {
+        bestMove = t_move();
     }
 
-    float bestScore;
+    t->setEntry(TableEntry(hash, bestMove, score, (uint8_t) depth, bound));
+}
 
-    std::vector<t_gameState> moves = generate_moves<color>(*game->state);
+template<bool color>
+static inline std::tuple<float, short> alphaBeta(int depth, float alpha, float beta, t_game *game, TranspositionTable *table, t_searchLimits *limits) {
 
-    // Apply move ordering by scoring moves as vision*score
-    std::vector<scoredMove *> sortedMoves = std::vector<scoredMove *>();
-    for (t_gameState x: moves) {
-        if constexpr (color) {
-            sortedMoves.push_back(scoreMove(x, &game->tableBlack, game));
-        } else {
-            sortedMoves.push_back(scoreMove(x, &game->tableWhite, game));
-        }
+    if (depth <= 0 || game->isOver) {
+        return {evaluate(game), 0};
     }
-    std::sort(sortedMoves.begin(), sortedMoves.end(), [](auto a, auto b) { return a > b; });
-    moves.clear();
+
+    if (limits->stop()) {
+        // Out of time, the caller discards the unfinished result
+        return {0, 0};
+    }
+
+    float bestScore;
 
     if constexpr (color) {
-        for (int i = (int) sortedMoves.size() - 1; i >= 0; i--) {
-            moves.push_back((*sortedMoves[i]->_move));
-            //moves.data()[i] = sortedMoves.data()[i]->_move;
-            delete sortedMoves[i];
+        // Black's turn -> Minimize score
+        uint64_t boardHash = game->state->hash;
+        TableEntry entry;
+        bool found = table->getEntry(boardHash, &entry);
+        if (found && probeCutoff(entry, depth, &alpha, &beta)) {
+            //printf("Found entry in table of %i entries.\n", table->getSize());
+            table->recordCutoff();
+            return {entry.getScore(), entry.getVision()};
         }
+        float alphaStart = alpha, betaStart = beta;  // Window searched, decides the bound of the result
 
-        bestScore = std::numeric_limits<float>::max();
+        // Moves are picked lazily, the best move of a shallower search of this position is tried first
+        t_move ttMove = found ? entry.getBestMove() : t_move();
+        MovePicker<true> picker(*game->state, ttMove, game->killers.at(depth));
 
-        if (moves.empty()) {
-            winner_t endType = checkEndNoMoves(false, game->state);
+        t_move currentMove = picker.next();
+        if (picker.ttMoveRejected()) {
+            table->recordCollision();
+        }
+        if (currentMove.isNull()) {
+            winner_t endType = checkEndNoMoves(false, picker.info());
 
             game->isOver = true;
             if (endType == winner_t::WHITE) {
@@ -263,52 +356,61 @@ static inline std::tuple<float, short> alphaBeta(int depth, float alpha, float b
             return {evaluate(game), 0};
         }
 
-        // Black's turn -> Minimize score
-        uint64_t boardHash = hash(game->random, game->state);
-        TableEntry *entry = game->tableBlack.getEntry(boardHash);
-        if (entry == nullptr || entry->getVision() < depth / 2) {
-            t_gameState *bestMove = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
-            std::tuple<float, short> score;
-            for (auto currentMove: moves) {
-                game->commitMove(currentMove);
-                score = alphaBeta<false>(depth-1, alpha, beta, game);
-                game->revertMove();
-
-                if (std::get<0>(score) <= bestScore) {
-                    bestScore = std::get<0>(score);
-                    memcpy(bestMove, &currentMove, sizeof(t_gameState));
-                }
+        bestScore = std::numeric_limits<float>::max();
 
-                beta = min(beta, bestScore);
+        t_move bestMove = t_move();
+        std::tuple<float, short> score;
+        for (; !currentMove.isNull(); currentMove = picker.next()) {
+            game->commitMove(currentMove, table);
+            score = alphaBeta<false>(depth-1, alpha, beta, game, table, limits);
+            game->revertMove();
 
-                if (beta <= alpha) {
-                    // BETA CUTOFF: "Opposing" team would always choose one of the already better moves
-                    break;
-                }
+            if (limits->stopped) {
+                return {0, 0};
             }
 
-            TableEntry* newEntry = new TableEntry(boardHash,bestMove->move, bestScore, std::get<1>(score));
-            game->tableBlack.setEntry(*newEntry);
+            if (std::get<0>(score) <= bestScore) {
+                bestScore = std::get<0>(score);
+                bestMove = currentMove;
+            }
 
-            free(bestMove);
+            beta = min(beta, bestScore);
 
-            return {bestScore, std::get<1>(score) + 1};
-        } else {
-            //printf("Found entry in Blacklist of %i entries.\n", game->tableBlack.getSize());
-            return {entry->getScore(), entry->getVision() + 1};
+            if (beta <= alpha) {
+                // BETA CUTOFF: "Opposing" team would always choose one of the already better moves
+                if (!currentMove.isCapture()) {
+                    game->killers.store(depth, currentMove);
+                }
+                break;
+            }
         }
 
+        storeResult<true>(table, boardHash, bestMove, bestScore, depth, alphaStart, betaStart);
+
+        return {bestScore, std::get<1>(score) + 1};
+
     } else {
-        for (int i = (int) sortedMoves.size() - 1; i >= 0; i--) {
-            moves.push_back((*sortedMoves[i]->_move));
-            //moves.data()[i] = sortedMoves.data()[i]->_move;
-            delete sortedMoves[i];
+        // White's turn -> Maximize score
+        uint64_t boardHash = game->state->hash;
+        TableEntry entry;
+        bool found = table->getEntry(boardHash, &entry);
+        if (found && probeCutoff(entry, depth, &alpha, &beta)) {
+            //printf("Found entry in table of %i entries.\n", table->getSize());
+            table->recordCutoff();
+            return {entry.getScore(), entry.getVision()};
         }
+        float alphaStart = alpha, betaStart = beta;  // Window searched, decides the bound of the result
 
-        bestScore = -std::numeric_limits<float>::max();
+        // Moves are picked lazily, the best move of a shallower search of this position is tried first
+        t_move ttMove = found ? entry.getBestMove() : t_move();
+        MovePicker<false> picker(*game->state, ttMove, game->killers.at(depth));
 
-        if (moves.empty()) {
-            winner_t endType = checkEndNoMoves(true, game->state);
+        t_move currentMove = picker.next();
+        if (picker.ttMoveRejected()) {
+            table->recordCollision();
+        }
+        if (currentMove.isNull()) {
+            winner_t endType = checkEndNoMoves(true, picker.info());
 
             game->isOver = true;
             if (endType == winner_t::WHITE) {
@@ -321,97 +423,118 @@ static inline std::tuple<float, short> alphaBeta(int depth, float alpha, float b
             return {evaluate(game), 0};
         }
 
-        // White's turn -> Maximize score
-        uint64_t boardHash = hash(game->random, game->state);
-        TableEntry* entry = game->tableWhite.getEntry(boardHash);
-        if (entry == nullptr || entry->getVision() < depth / 2) {
-            t_gameState *bestMove = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
-            std::tuple<float, short> score;
-            for (auto currentMove: moves) {
-                game->commitMove(currentMove);
-                score = alphaBeta<true>(depth - 1, alpha, beta, game);
-                game->revertMove();
-
-                if (std::get<0>(score) >= bestScore) {
-                    bestScore = std::get<0>(score);
-                    memcpy(bestMove, &currentMove, sizeof(t_gameState));
-                }
+        bestScore = -std::numeric_limits<float>::max();
 
-                alpha = max(alpha, bestScore);
+        t_move bestMove = t_move();
+        std::tuple<float, short> score;
+        for (; !currentMove.isNull(); currentMove = picker.next()) {
+            game->commitMove(currentMove, table);
+            score = alphaBeta<true>(depth - 1, alpha, beta, game, table, limits);
+            game->revertMove();
 
-                if (beta <= alpha) {
-                    // ALPHA CUTOFF: "Opposing" team would always choose one of the already better moves
-                    break;
-                }
+            if (limits->stopped) {
+                return {0, 0};
+            }
+
+            if (std::get<0>(score) >= bestScore) {
+                bestScore = std::get<0>(score);
+                bestMove = currentMove;
             }
-            TableEntry* newEntry = new TableEntry(boardHash, bestMove->move, bestScore, std::get<1>(score) + 1);
-            game->tableWhite.setEntry(*newEntry);
 
-            free(bestMove);
+            alpha = max(alpha, bestScore);
 
-            return {bestScore, std::get<1>(score) + 1};
-        } else {
-            //printf("Found entry in Whitelist of %i entries.\n", game->tableWhite.getSize());
-            return {entry->getScore(), entry->getVision() + 1};
+            if (beta <= alpha) {
+                // ALPHA CUTOFF: "Opposing" team would always choose one of the already better moves
+                if (!currentMove.isCapture()) {
+                    game->killers.store(depth, currentMove);
+                }
+                break;
+            }
         }
+        storeResult<false>(table, boardHash, bestMove, bestScore, depth, alphaStart, betaStart);
+
+        return {bestScore, std::get<1>(score) + 1};
     }
 }
 
 
 template<bool color>
-static inline std::pair<t_gameState, float> alphaBetaHead(t_game *game, int max_depth);
-
-
-template<>
-inline std::pair<t_gameState, float> alphaBetaHead<true>(t_game *game, int max_depth) {
-    double timePerMove = game->blackMoveTime / game->blackMovesRemaining;
-    timePerMove = pow(timePerMove, 2.f/3.f) + timePerMove;
-
+static inline float searchRoot(MoveList *moves, int depth, t_game *game, TranspositionTable *table, t_searchLimits *limits,
+                               int *bestIndex) {
+    /* Search every root move depth plies deep and return the best score, its move is stored at bestIndex
+     * The result is incomplete if the search was stopped meanwhile (limits->stopped)
+     */
     float alpha = -std::numeric_limits<float>::max();
     float beta = std::numeric_limits<float>::max();
+    float bestScore = color ? beta : alpha;
 
-    float bestScore;
-    t_gameState zeroMove = t_gameState(game->board(), t_move());
-    t_gameState *bestMove = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
-    memcpy(bestMove, &zeroMove, sizeof(t_gameState));
-
-    std::chrono::steady_clock::time_point generateStart = std::chrono::steady_clock::now();
-    std::vector<t_gameState> moves = generate_moves<true>(*game->state);
-    std::chrono::steady_clock::time_point generateStop = std::chrono::steady_clock::now();
-    std::chrono::nanoseconds diff = std::chrono::duration_cast<std::chrono::nanoseconds>(generateStop - generateStart);
-    double diffSeconds = (double) diff.count() / 1e9f;
-
-    short moveSize = (short) moves.size();
-    if (abs(game->averageMoveCount - moveSize) > (game->averageMoveCount * 0.3)) {
-        moveSize = game->averageMoveCount;
-    } else {
-        game->updateAverageMoves(moveSize);
-    }
-
-    int depthEstimate = (int )(log((double )timePerMove / diffSeconds) / log((double )moveSize * LAYER_SIZE_CORRECTION));
-    depthEstimate = max(depthEstimate, max_depth); //min(depthEstimate, max_depth);
+    *bestIndex = 0;
+    for (int i = 0; i < moves->size(); i++) {
+        game->commitMove((*moves)[i], table);
+        std::tuple<float, short> score = alphaBeta<!color>(depth - 1, alpha, beta, game, table, limits);
+        game->revertMove();
 
-    printf("Generating moves for black with depth %d (%d, %d)\n", depthEstimate, game->averageMoveCount, moveSize);
+        if (limits->stopped) {
+            break;
+        }
 
-    // Apply move ordering by scoring moves as vision*score
-    std::vector<scoredMove *> sortedMoves = std::vector<scoredMove *>();
-    for (t_gameState x: moves) {
-        sortedMoves.push_back(scoreMove(x, &game->tableBlack, game));
+        if constexpr (color) {
+            // Black's turn -> Minimize score
+            if (std::get<0>(score) < bestScore) {
+                bestScore = std::get<0>(score);
+                *bestIndex = i;
+            }
+            beta = min(beta, bestScore);
+        } else {
+            // White's turn -> Maximize score
+            if (std::get<0>(score) > bestScore) {
+                bestScore = std::get<0>(score);
+                *bestIndex = i;
+            }
+            alpha = max(alpha, bestScore);
+        }
     }
-    std::sort(sortedMoves.begin(), sortedMoves.end(), [](auto a, auto b) { return a > b; });
-    moves.clear();
 
-    for (int i = (int) sortedMoves.size() - 1; i >= 0; i--) {
-        moves.push_back((*sortedMoves[i]->_move));
-        //moves.data()[i] = sortedMoves.data()[i]->_move;
-        delete sortedMoves[i];
-    }
+    return bestScore;
+}
+
+
+template<bool color>
+static inline t_searchLimits searchTimes(const t_game *game) {
+    // Deadlines of a search for color starting now, from the time left to color and the moves it still has to play
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    double moveTime = color ? game->blackMoveTime : game->whiteMoveTime;
+    int movesRemaining = max((int) (color ? game->blackMovesRemaining : game->whiteMovesRemaining), SEARCH_MIN_MOVES_REMAINING);
+    double timePerMove = std::max(moveTime, 0.0) / movesRemaining;
+
+    t_searchLimits limits;
+    limits.softDeadline = start + searchDuration(timePerMove * SEARCH_SOFT_LIMIT);
+    limits.hardDeadline = start + searchDuration(
+            std::min(timePerMove * SEARCH_HARD_LIMIT, std::max(moveTime, 0.0) * SEARCH_HARD_MAX_SHARE));
+    return limits;
+}
 
 
-    bestScore = std::numeric_limits<float>::max();
+template<bool color>
+static inline std::pair<t_move, float> iterativeDeepening(t_game *game, TranspositionTable *table, int max_depth,
+                                                          t_searchLimits *limits) {
+    /* Search the root one ply deeper at a time, up to max_depth
+     * Every iteration starts with the best move of the one before, deeper in the tree the table supplies the moves of
+     * the previous iteration. No iteration is started after the soft deadline or if it would likely run past the hard
+     * deadline, judged by the time of the last iteration and how much it grew over the one before. The running
+     * iteration is abandoned at the hard deadline, and the best move of the last completed iteration is played.
+     */
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    t_move zeroMove = t_move();
+
+    MoveList moves;
+    t_positionInfo info = getPositionInfo<color>(game->board());
+    generate_moves<color>(*game->state, info, &moves);
 
     if (moves.empty()) {
-        winner_t endType = checkEndNoMoves(false, game->state);
+        winner_t endType = checkEndNoMoves(!color, info);
 
         game->isOver = true;
         if (endType == winner_t::WHITE) {
@@ -424,113 +547,76 @@ inline std::pair<t_gameState, float> alphaBetaHead<true>(t_game *game, int max_d
         return {zeroMove, evaluate(game)};
     }
 
-    // Black's turn -> Minimize score
-    std::tuple<float, short> score;
-    for (auto currentMove: moves) {
-        game->commitMove(currentMove);
-        score = alphaBeta<false>(depthEstimate - 1, alpha, beta, game);
-        game->revertMove();
+    // New search generation, entries of earlier searches are replaced first
+    table->ageingTable();
+    table->resetStats();
 
-        if (std::get<0>(score) <= bestScore) {
-            bestScore = std::get<0>(score);
-            memcpy(bestMove, &currentMove, sizeof(t_gameState));
-        }
-
-        beta = min(beta, bestScore);
-    }
+    sortMoves<color>(&moves, table, game);
 
-    t_gameState returnMove = t_gameState(*bestMove);
-    free(bestMove);
+    // The first move is played if not even the first iteration completes
+    t_move bestMove = moves[0];
+    float bestScore = 0;
 
-    return {returnMove, bestScore};
-}
+    // The first iteration always completes, so there is a searched move to play
+    std::chrono::steady_clock::time_point hardDeadline = limits->hardDeadline;
+    limits->hardDeadline = std::chrono::steady_clock::time_point::max();
 
+    double previousTime = 0;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        std::chrono::steady_clock::time_point iterationStart = std::chrono::steady_clock::now();
 
-template<>
-inline std::pair<t_gameState, float> alphaBetaHead<false>(t_game *game, int max_depth) {
-    double timePerMove = game->whiteMoveTime / game->whiteMovesRemaining;
-    timePerMove = pow(timePerMove, 2.f/3.f) + timePerMove;
-
-    float alpha = -std::numeric_limits<float>::max();
-    float beta = std::numeric_limits<float>::max();
-    float bestScore;
-    t_gameState zeroMove = t_gameState(game->board(), t_move());
-    t_gameState *bestMove = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
-    memcpy(bestMove, &zeroMove, sizeof(t_gameState));
-
-    std::chrono::steady_clock::time_point generateStart = std::chrono::steady_clock::now();
-    std::vector<t_gameState> moves = generate_moves<false>(*game->state);
-    std::chrono::steady_clock::time_point generateStop = std::chrono::steady_clock::now();
-    std::chrono::nanoseconds diff = std::chrono::duration_cast<std::chrono::nanoseconds>(generateStop - generateStart);
-    double diffSeconds = (double) diff.count() / 1e9f;
-
-    short moveSize = (short) moves.size();
-    if (abs(game->averageMoveCount - moveSize) > (game->averageMoveCount * 0.3)) {
-        moveSize = game->averageMoveCount;
-    } else {
-        game->updateAverageMoves(moveSize);
-    }
-
-    int depthEstimate = (int )(log((double )timePerMove / diffSeconds) / log((double )moveSize * LAYER_SIZE_CORRECTION));
-    depthEstimate = max(depthEstimate, max_depth);
-
-    printf("Generating moves for white with depth %d (%d, %d)\n", depthEstimate, game->averageMoveCount, moveSize);
-
-
-    // Apply move ordering by scoring moves as vision*score
-    std::vector<scoredMove *> sortedMoves = std::vector<scoredMove *>();
-    for (t_gameState x: moves) {
-        sortedMoves.push_back(scoreMove(x, &game->tableWhite, game));
-    }
-    std::sort(sortedMoves.begin(), sortedMoves.end(), [](auto a, auto b) { return a > b; });
-    moves.clear();
-
-    for (int i = (int) sortedMoves.size() - 1; i >= 0; i--) {
-        moves.push_back((*sortedMoves[i]->_move));
-        //moves.data()[i] = sortedMoves.data()[i]->_move;
-        delete sortedMoves[i];
-    }
-
-
-    bestScore = -std::numeric_limits<float>::max();
+        int bestIndex;
+        float score = searchRoot<color>(&moves, depth, game, table, limits, &bestIndex);
+        if (limits->stopped) {
+            printf("Stopped depth %d at the hard deadline\n", depth);
+            break;
+        }
+        limits->hardDeadline = hardDeadline;
+        limits->completedDepth = depth;
 
-    if (moves.empty()) {
-        winner_t endType = checkEndNoMoves(true, game->state);
+        bestMove = moves[bestIndex];
+        bestScore = score;
+        storeResult<color>(table, game->state->hash, bestMove, bestScore, depth,
+                           -std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
 
-        game->isOver = true;
-        if (endType == winner_t::WHITE) {
-            game->whiteWon = true;
+        // Search the best move first in the next iteration, the others keep their order
+        for (int i = bestIndex; i > 0; i--) {
+            moves[i] = moves[i - 1];
         }
-        if (endType == winner_t::BLACK) {
-            game->blackWon = true;
+        moves[0] = bestMove;
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        printf("Depth %d: ", depth);
+        printMove(bestMove, ' ');
+        printf("with score %f [%fs]\n", bestScore, std::chrono::duration<double>(now - start).count());
+
+        // The next iteration takes about as much longer as this one took over the one before
+        double iterationTime = std::chrono::duration<double>(now - iterationStart).count();
+        double branching = previousTime > 0 ? std::clamp(iterationTime / previousTime, SEARCH_MIN_BRANCHING, SEARCH_MAX_BRANCHING)
+                                            : SEARCH_MIN_BRANCHING;
+        previousTime = iterationTime;
+
+        if (moves.size() == 1 || now >= limits->softDeadline || now + searchDuration(iterationTime * branching) >= hardDeadline) {
+            // A single move needs no search, and a deeper iteration would likely not finish in time
+            break;
         }
-
-        return {zeroMove, evaluate(game)};
     }
 
-    // White's turn -> Maximize score
-    std::tuple<float, short> score;
-    for (auto currentMove: moves) {
-        game->commitMove(currentMove);
-        score = alphaBeta<true>(depthEstimate - 1, alpha, beta, game);
-        game->revertMove();
-
-        if (std::get<0>(score) >= bestScore) {
-            bestScore = std::get<0>(score);
-            memcpy(bestMove, &currentMove, sizeof(t_gameState));
-        }
+    table->printStats();
 
-        alpha = max(alpha, bestScore);
-    }
+    return {bestMove, bestScore};
+}
 
-    t_gameState returnMove = t_gameState(*bestMove);
-    free(bestMove);
 
-    return {returnMove, bestScore};
+template<bool color>
+static inline std::pair<t_move, float> alphaBetaHead(t_game *game, TranspositionTable *table, int max_depth) {
+    // Iterative deepening within the time color has for its move, see searchTimes
+    t_searchLimits limits = searchTimes<color>(game);
+    return iterativeDeepening<color>(game, table, max_depth, &limits);
 }
 
 
-void monteCarloSimulate(MonteCarloTree *tree, Node *originNode, int max_depth) {
+inline void monteCarloSimulate(MonteCarloTree *tree, Node *originNode, int max_depth) {
     /// Traverse nodes
     Node *leafNode = tree->traverse(originNode);
 
@@ -562,7 +648,7 @@ void monteCarloSimulate(MonteCarloTree *tree, Node *originNode, int max_depth) {
 }
 
 
-std::pair<t_gameState, MonteCarloTree *> monteCarlo(MonteCarloTree *tree, int simulation_iterations, int max_parallel_simulations, int max_depth) {
+inline std::pair<t_move, MonteCarloTree *> monteCarlo(MonteCarloTree *tree, int simulation_iterations, int max_parallel_simulations, int max_depth) {
     std::vector<Node *> targetNodes = std::vector<Node *>();
     if (tree->root()->isLeaf()) {
         /// Root is the only node in the tree -> Expand root node
@@ -570,9 +656,7 @@ std::pair<t_gameState, MonteCarloTree *> monteCarlo(MonteCarloTree *tree, int si
 
         // Return error state if there are no children
         if (tree->root()->isLeaf()) {
-            t_gameState zeroMove = t_gameState(tree->root()->game()->board(), t_move());
-
-            return {zeroMove, tree};
+            return {t_move(), tree};
         }
 
         /// Select "best" child nodes at random, as no evaluations are available yet
@@ -623,29 +707,29 @@ std::pair<t_gameState, MonteCarloTree *> monteCarlo(MonteCarloTree *tree, int si
 
     /// Select best child of the root after running simulations. This node contains the current best move
     Node *bestNode = tree->select(tree->root());
-    return {*bestNode->game()->state, new MonteCarloTree(bestNode)};
+    return {bestNode->game()->state->move, new MonteCarloTree(bestNode)};
 }
 
 
 template<bool color>
-inline std::pair<gameState, float> getMoveAlphaBeta(t_game *game) {
-    return alphaBetaHead<color>(game, 100);
+inline std::pair<t_move, float> getMoveAlphaBeta(t_game *game, TranspositionTable *table) {
+    return alphaBetaHead<color>(game, table, 100);
 }
 
 
 template<>
-inline std::pair<gameState, float> getMoveAlphaBeta<true>(t_game *game) {
-    return alphaBetaHead<true>(game, 100);
+inline std::pair<t_move, float> getMoveAlphaBeta<true>(t_game *game, TranspositionTable *table) {
+    return alphaBetaHead<true>(game, table, 100);
 }
 
 
 template<>
-inline std::pair<gameState, float> getMoveAlphaBeta<false>(t_game *game) {
-    return alphaBetaHead<false>(game, 100);
+inline std::pair<t_move, float> getMoveAlphaBeta<false>(t_game *game, TranspositionTable *table) {
+    return alphaBetaHead<false>(game, table, 100);
 }
 
 
-std::pair<gameState, MonteCarloTree *> getMoveMonteCarlo(MonteCarloTree *tree) {
+inline std::pair<t_move, MonteCarloTree *> getMoveMonteCarlo(MonteCarloTree *tree) {
     return monteCarlo(tree, 100, 16, 20);
 }
 
@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "largePages.h"
+
+
+t_largeAllocation allocateLarge(size_t size) {
+    // Memory of at least size bytes, on the largest pages available. Throws std::bad_alloc if there is none at all
+    t_largeAllocation allocation;
+    allocation.size = (size + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * LARGE_PAGE_SIZE;
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    // Explicit huge pages only exist if reserved (vm.nr_hugepages), mapping fails right away otherwise
+    void *mapped = mmap(nullptr, allocation.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mapped != MAP_FAILED) {
+        allocation.memory = mapped;
+        allocation.pages = pageKind::explicitHuge;
+        return allocation;
+    }
+#endif
+
+    allocation.memory = std::aligned_alloc(LARGE_PAGE_SIZE, allocation.size);
+    if (allocation.memory == nullptr) {
+        throw std::bad_alloc();
+    }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // Must be advised before the memory is first touched, the pages are allocated on first write
+    if (madvise(allocation.memory, allocation.size, MADV_HUGEPAGE) == 0) {
+        allocation.pages = pageKind::transparentHuge;
+    }
+#endif
+
+    return allocation;
+}
+
+void freeLarge(t_largeAllocation *allocation) {
+    if (allocation->memory == nullptr) {
+        return;
+    }
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    if (allocation->pages == pageKind::explicitHuge) {
+        munmap(allocation->memory, allocation->size);
+        *allocation = t_largeAllocation();
+        return;
+    }
+#endif
+
+    free(allocation->memory);
+    *allocation = t_largeAllocation();
+}
+
+
+size_t hugePageBytes(const t_largeAllocation &allocation) {
+    /* Bytes of the allocation currently backed by huge pages
+     * Explicit huge pages always are. For transparent ones the kernel's count (AnonHugePages in /proc/self/smaps) of the
+     * mappings overlapping the allocation is taken, 0 where it can't be read.
+     */
+    if (allocation.pages == pageKind::explicitHuge) {
+        return allocation.size;
+    }
+    if (allocation.pages == pageKind::regular) {
+        return 0;
+    }
+
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == nullptr) {
+        return 0;
+    }
+
+    uintptr_t start = (uintptr_t) allocation.memory;
+    uintptr_t end = start + allocation.size;
+
+    size_t bytes = 0;
+    bool overlapping = false;
+    char line[256];
+    while (fgets(line, sizeof(line), smaps) != nullptr) {
+        unsigned long mappingStart, mappingEnd;
+        size_t kilobytes;
+        if (sscanf(line, "%lx-%lx ", &mappingStart, &mappingEnd) == 2) {
+            overlapping = mappingStart < end && mappingEnd > start;
+        } else if (overlapping && sscanf(line, "AnonHugePages: %zu kB", &kilobytes) == 1) {
+            bytes += kilobytes * 1024;
+        }
+    }
+    fclose(smaps);
+
+    return bytes < allocation.size ? bytes : allocation.size;
+}
+
+const char *pageKindName(pageKind pages) {
+    switch (pages) {
+        case pageKind::explicitHuge:
+            return "explicit huge pages";
+        case pageKind::transparentHuge:
+            return "transparent huge pages";
+        default:
+            return "regular pages";
+    }
+}
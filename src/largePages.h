@@ -0,0 +1,40 @@
+#ifndef KINGOFTHEHILL_KI_LARGEPAGES_H
+#define KINGOFTHEHILL_KI_LARGEPAGES_H
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ * Large page allocation
+ * Tables of hundreds of megabytes spread their lookups over so many 4 KB pages that most of them miss the TLB. Large
+ * allocations are therefore backed by 2 MB huge pages where the system provides them: Explicit huge pages (MAP_HUGETLB)
+ * if some are reserved, else transparent huge pages requested with madvise(MADV_HUGEPAGE) on 2 MB aligned memory, else
+ * regular pages. Memory returned is cache line aligned in every case, but not initialized: The owner constructs its
+ * contents, which also is when the pages get allocated.
+ */
+
+#define LARGE_PAGE_SIZE ((size_t) 2 * 1024 * 1024)
+
+
+enum class pageKind : uint8_t {
+    regular,
+    transparentHuge,  // Requested, the kernel may still back parts with regular pages, see hugePageBytes
+    explicitHuge
+};
+
+typedef struct largeAllocation {
+    void *memory = nullptr;
+    size_t size = 0;  // Bytes allocated, the requested size rounded up to whole huge pages
+    pageKind pages = pageKind::regular;
+} t_largeAllocation;
+
+
+t_largeAllocation allocateLarge(size_t size);
+void freeLarge(t_largeAllocation *allocation);
+
+size_t hugePageBytes(const t_largeAllocation &allocation);
+const char *pageKindName(pageKind pages);
+
+#endif //KINGOFTHEHILL_KI_LARGEPAGES_H
@@ -66,7 +66,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (wQueens != 0) {
         short shift = findFirst(wQueens);
         score += QUEEN_VALUE + pst_queen_white[shift];
-        wQueens &= (wQueens - 1);
+        wQueens = clearFirst(wQueens);
     }
 
     // Rooks
@@ -74,7 +74,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (wRooks != 0) {
         short shift = findFirst(wRooks);
         score += ROOK_VALUE + pst_rook_white[shift];
-        wRooks &= (wRooks - 1);
+        wRooks = clearFirst(wRooks);
     }
 
     // Bishops
@@ -82,7 +82,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (wBishops != 0) {
         short shift = findFirst(wBishops);
         score += BISHOP_VALUE + pst_bishop_white[shift];
-        wBishops &= (wBishops - 1);
+        wBishops = clearFirst(wBishops);
     }
 
     // Knight
@@ -90,7 +90,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (wKnights != 0) {
         short shift = findFirst(wKnights);
         score += KNIGHT_VALUE + pst_knight_white[shift];
-        wKnights &= (wKnights - 1);
+        wKnights = clearFirst(wKnights);
     }
 
     // Pawns
@@ -98,7 +98,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (wPawns != 0) {
         short shift = findFirst(wPawns);
         score += PAWN_VALUE + pst_pawn_white[shift];
-        wPawns &= (wPawns - 1);
+        wPawns = clearFirst(wPawns);
     }
 
 
@@ -115,7 +115,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (bQueens != 0) {
         short shift = findFirst(bQueens);
         score -= QUEEN_VALUE + pst_queen_black[shift];
-        bQueens &= (bQueens - 1);
+        bQueens = clearFirst(bQueens);
     }
 
     // Rooks
@@ -123,7 +123,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (bRooks != 0) {
         short shift = findFirst(bRooks);
         score -= ROOK_VALUE + pst_rook_black[shift];
-        bRooks &= (bRooks - 1);
+        bRooks = clearFirst(bRooks);
     }
 
     // Bishops
@@ -131,7 +131,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (bBishops != 0) {
         short shift = findFirst(bBishops);
         score -= BISHOP_VALUE + pst_bishop_black[shift];
-        bBishops &= (bBishops - 1);
+        bBishops = clearFirst(bBishops);
     }
 
     // Knight
@@ -139,7 +139,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (bKnights != 0) {
         short shift = findFirst(bKnights);
         score -= KNIGHT_VALUE + pst_knight_black[shift];
-        bKnights &= (bKnights - 1);
+        bKnights = clearFirst(bKnights);
     }
 
     // Pawns
@@ -147,7 +147,7 @@ inline float evaluateMonteCarlo(t_game *game) {
     while (bPawns != 0) {
         short shift = findFirst(bPawns);
         score -= PAWN_VALUE + pst_pawn_black[shift];
-        bPawns &= (bPawns - 1);
+        bPawns = clearFirst(bPawns);
     }
 
 
@@ -317,15 +317,15 @@ public:
 
     static void expand(Node *node) {
         // Generate all possible moves for the current player
-        std::vector<t_gameState> possibleMoves;
+        MoveList possibleMoves;
         if (node->game()->turn) {
-            possibleMoves = generate_moves<true>(*node->game()->state);
+            generate_moves<true>(*node->game()->state, &possibleMoves);
         } else {
-            possibleMoves = generate_moves<false>(*node->game()->state);
+            generate_moves<false>(*node->game()->state, &possibleMoves);
         }
 
         // Generate child node for each move
-        for (auto move : possibleMoves) {
+        for (const t_move move : possibleMoves) {
             // Create child node with copy of current game, then commit the move on the new node
             Node *newNode = new Node(node, *node->game());
             newNode->game()->commitMove(move);
@@ -336,11 +336,11 @@ public:
     }
 
     static void addRandom(Node *node) {
-        std::vector<t_gameState> possibleMoves;
+        MoveList possibleMoves;
         if (node->game()->turn) {
-            possibleMoves = generate_moves<true>(*node->game()->state);
+            generate_moves<true>(*node->game()->state, &possibleMoves);
         } else {
-            possibleMoves = generate_moves<false>(*node->game()->state);
+            generate_moves<false>(*node->game()->state, &possibleMoves);
         }
 
         if (possibleMoves.empty()) {
@@ -348,7 +348,7 @@ public:
         }
 
         int randomMoveIndex = randn(0, (int )possibleMoves.size());
-        t_gameState randomMove = possibleMoves.at(randomMoveIndex);
+        t_move randomMove = possibleMoves.at(randomMoveIndex);
 
         // Create child node with copy of current game, then commit the selected move on the new node
         Node *newNode = new Node(node, *node->game());
@@ -382,7 +382,7 @@ public:
 
         // Check for winner if the node is still a leaf (no moves are available)
         if (leafNode->isLeaf()) {
-            winner = checkEndNoMoves(leafNode->game()->turn, leafNode->game()->state);
+            winner = checkEndNoMoves(!leafNode->game()->turn, leafNode->game()->state);
 
 //            if (winner == winner_t::DRAW) {
 //                return {leafNode, 0};  // TODO: Return something other than 0?
@@ -2,61 +2,117 @@
 #define KINGOFTHEHILL_KI_MOVE_H
 
 
-#include <cmath>
 #include <cstdint>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
 
 #include "util.h"
+#include "bits.h"
 #include "board.h"
+#include "hashKeys.h"
 #include "moveMaps.h"
 
 
 /*
- * Move representation
- * Origin Position (1x6 bit)
- * Target Position (1x6 bit)
- * Taken Figure (3 bit)
- * Turn color (1 bit)
+ * Packed move representation
+ * Origin position (6 bit)
+ * Target position (6 bit)
+ * Flags (4 bit): Capture, promotion and special moves, see MOVE_FLAG_*
  * => Total 16 bit / 2 bytes
+ *
+ * A zero move (a8 -> a8) never occurs as a real move and is used as null move
  */
 
-typedef struct move_old {
-    unsigned origin: 6;
-    unsigned target: 6;
-    unsigned taken_figure: 3 = 0;  // 0 -> Non taken, 1 -> Queen, 2 -> Rook, 3 -> Bishop, 4 -> Knight, 5 -> Pawn (?)
-    unsigned color: 1;
-    unsigned promoted: 1 = 0;
-    unsigned promoted_to: 2 = 0;
-    unsigned castled_short: 1 = 0;
-    unsigned castled_long: 1 = 0;
-    unsigned enpassants: 4 = 0;
-    unsigned disable_short_castle: 1 = 0;
-    unsigned disable_long_castle: 1 = 0;
-
-    move_old(short org, short trg, bool col) : origin(org), target(trg), color(col) {}
-    move_old() : origin(0), target(0), color(0) {}
-} t_move_old;
+#define MOVE_FLAG_QUIET 0b0000
+#define MOVE_FLAG_DOUBLE_PUSH 0b0001
+#define MOVE_FLAG_CASTLE_SHORT 0b0010
+#define MOVE_FLAG_CASTLE_LONG 0b0011
+#define MOVE_FLAG_CAPTURE 0b0100
+#define MOVE_FLAG_EN_PASSANT 0b0101
+#define MOVE_FLAG_PROMOTION 0b1000  // Lowest two bits select the piece: Knight, bishop, rook, queen
 
+#define MOVE_PROMOTION_KNIGHT 0
+#define MOVE_PROMOTION_BISHOP 1
+#define MOVE_PROMOTION_ROOK 2
+#define MOVE_PROMOTION_QUEEN 3
 
 typedef struct move {
-    const uint64_t originMap;
-    const uint64_t targetMap;
+    uint16_t data;
+
+    move() = default;
+    constexpr move(uint8_t originShift, uint8_t targetShift, uint8_t flags) :
+            data((uint16_t) (originShift | (targetShift << 6) | (flags << 12))) {}
+
+    uint8_t origin() const {
+        return data & 0b111111;
+    }
+
+    uint8_t target() const {
+        return (data >> 6) & 0b111111;
+    }
+
+    uint8_t flags() const {
+        return data >> 12;
+    }
+
+    uint64_t originMap() const {
+        return (uint64_t) 1 << origin();
+    }
+
+    uint64_t targetMap() const {
+        return (uint64_t) 1 << target();
+    }
+
+    bool isCapture() const {
+        return (flags() & MOVE_FLAG_CAPTURE) != 0;
+    }
+
+    bool isPromotion() const {
+        return (flags() & MOVE_FLAG_PROMOTION) != 0;
+    }
+
+    piece promotion() const {
+        switch (flags() & 0b11) {
+            case MOVE_PROMOTION_KNIGHT:
+                return piece::knight;
+            case MOVE_PROMOTION_BISHOP:
+                return piece::bishop;
+            case MOVE_PROMOTION_ROOK:
+                return piece::rook;
+            default:
+                return piece::queen;
+        }
+    }
 
-    move() : originMap(0), targetMap(0) {}
-    move(uint64_t origin, uint64_t target) : originMap(origin), targetMap(target) {}
-    move(const move &other) = default;
+    bool isNull() const {
+        return data == 0;
+    }
+
+    bool operator==(const move &other) const {
+        return data == other.data;
+    }
+
+    bool operator!=(const move &other) const {
+        return data != other.data;
+    }
 } t_move;
 
 
 typedef struct gameState {
-    const t_board board;
-    const t_move move;
+    t_board board;
+    t_move move;
 
-    const unsigned wCastleShort: 1;
-    const unsigned wCastleLong: 1;
-    const unsigned bCastleShort: 1;
-    const unsigned bCastleLong: 1;
+    unsigned wCastleShort: 1;
+    unsigned wCastleLong: 1;
+    unsigned bCastleShort: 1;
+    unsigned bCastleLong: 1;
 
-    const unsigned enpassant: 4;
+    unsigned enpassant: 4;  // File of a double pushed pawn plus one, zero if there is none
+
+    uint64_t hash;  // Position hash with color to move, set by whoever builds the state and kept up by makeMove
 
     gameState(const t_board &brd, t_move mov,
                         unsigned whiteCastleShort, unsigned whiteCastleLong,
@@ -65,7 +121,7 @@ typedef struct gameState {
             board(brd), move(mov),
             wCastleShort(whiteCastleShort), wCastleLong(whiteCastleLong),
             bCastleShort(blackCastleShort), bCastleLong(blackCastleLong),
-            enpassant(en_passant) {}
+            enpassant(en_passant), hash(0) {}
     gameState(const t_board &brd,
               unsigned whiteCastleShort, unsigned whiteCastleLong,
               unsigned blackCastleShort, unsigned blackCastleLong,
@@ -73,561 +129,624 @@ typedef struct gameState {
             board(brd), move(),
             wCastleShort(whiteCastleShort), wCastleLong(whiteCastleLong),
             bCastleShort(blackCastleShort), bCastleLong(blackCastleLong),
-            enpassant(en_passant) {}
+            enpassant(en_passant), hash(0) {}
     gameState(const t_board &brd, t_move mov) :
             board(brd), move(mov),
             wCastleShort(true), wCastleLong(true),
             bCastleShort(true), bCastleLong(true),
-            enpassant(0) {}
+            enpassant(0), hash(0) {}
     explicit gameState(const t_board &brd) :
             board(brd), move(),
             wCastleShort(true), wCastleLong(true),
             bCastleShort(true), bCastleLong(true),
-            enpassant(0) {}
+            enpassant(0), hash(0) {}
 
     gameState(const gameState &state) = default;
 } t_gameState;
 
 
-inline static uint8_t findFirst(const uint64_t pieces) {
-    return static_cast<uint8_t>(log2(static_cast<double>(pieces & -pieces)));
-}
+/*
+ * Move list
+ * Fixed-capacity buffer for generated moves, meant to live on the caller's stack, so generating moves never touches
+ * the allocator. No position has more than 218 legal moves, the capacity leaves some headroom on top of that.
+ */
 
+#define MAX_MOVES 256
 
-inline static uint16_t occIdentifier(uint64_t moveMap, const uint64_t occ) {
-    uint16_t occIdentifier = 0;
-    for (long bitNumber = 1; moveMap != 0; bitNumber += bitNumber) {
-        if ((occ & moveMap & -moveMap) != 0) {
-            occIdentifier += bitNumber;
-        }
-        moveMap &= (moveMap - 1);
-    }
+class MoveList {
+private:
+    t_move _moves[MAX_MOVES];
+    uint16_t _size = 0;
 
-    return occIdentifier;
-}
+public:
+    MoveList() = default;
+    MoveList(const MoveList &other) = delete;
+    MoveList &operator=(const MoveList &other) = delete;
 
+    void push_back(const t_move mov) {
+        _moves[_size++] = mov;
+    }
 
-template<piece p, bool color>
-inline static t_board move(t_board currentBoard, uint64_t origin, uint64_t target) {
-    uint64_t wk = currentBoard.whiteKing;
-    uint64_t wq = currentBoard.whiteQueen;
-    uint64_t wr = currentBoard.whiteRook;
-    uint64_t wb = currentBoard.whiteBishop;
-    uint64_t wn = currentBoard.whiteKnight;
-    uint64_t wp = currentBoard.whitePawn;
+    void emplace_back(uint8_t originShift, uint8_t targetShift, uint8_t flags) {
+        _moves[_size++] = t_move(originShift, targetShift, flags);
+    }
 
-    uint64_t bk = currentBoard.blackKing;
-    uint64_t bq = currentBoard.blackQueen;
-    uint64_t br = currentBoard.blackRook;
-    uint64_t bb = currentBoard.blackBishop;
-    uint64_t bn = currentBoard.blackKnight;
-    uint64_t bp = currentBoard.blackPawn;
+    void clear() {
+        _size = 0;
+    }
 
-    uint64_t move = origin | target;
+    t_move *data() {
+        return _moves;
+    }
 
-    if (color) {
-        // Black is moving
-
-        if (p == piece::king)
-            return {wk & ~target, wq & ~target, wr & ~target, wb & ~target, wn & ~target, wp & ~target,
-                    bk ^ move, bq, br, bb, bn, bp};
-        if (p == piece::queen)
-            return {wk & ~target, wq & ~target, wr & ~target, wb & ~target, wn & ~target, wp & ~target,
-                    bk, bq ^ move, br, bb, bn, bp};
-        if (p == piece::rook)
-            return {wk & ~target, wq & ~target, wr & ~target, wb & ~target, wn & ~target, wp & ~target,
-                    bk, bq, br ^ move, bb, bn, bp};
-        if (p == piece::bishop)
-            return {wk & ~target, wq & ~target, wr & ~target, wb & ~target, wn & ~target, wp & ~target,
-                    bk, bq, br, bb ^ move, bn, bp};
-        if (p == piece::knight)
-            return {wk & ~target, wq & ~target, wr & ~target, wb & ~target, wn & ~target, wp & ~target,
-                    bk, bq, br, bb, bn ^ move, bp};
-        if (p == piece::pawn)
-            return {wk & ~target, wq & ~target, wr & ~target, wb & ~target, wn & ~target, wp & ~target,
-                    bk, bq, br, bb, bn, bp ^ move};
-        if (p == piece::none)
-            return {wk & ~target, wq & ~target, wr & ~target, wb & ~target, wn & ~target, wp & ~target,
-                    bk, bq, br, bb, bn, bp};
-    } else {
-        // White is moving
-
-        if (p == piece::king)
-            return {wk ^ move, wq, wr, wb, wn, wp,
-                    bk & ~target, bq & ~target, br & ~target, bb & ~target, bn & ~target, bp & ~target};
-        if (p == piece::queen)
-            return {wk, wq ^ move, wr, wb, wn, wp,
-                    bk & ~target, bq & ~target, br & ~target, bb & ~target, bn & ~target, bp & ~target};
-        if (p == piece::rook)
-            return {wk, wq, wr ^ move, wb, wn, wp,
-                    bk & ~target, bq & ~target, br & ~target, bb & ~target, bn & ~target, bp & ~target};
-        if (p == piece::bishop)
-            return {wk, wq, wr, wb ^ move, wn, wp,
-                    bk & ~target, bq & ~target, br & ~target, bb & ~target, bn & ~target, bp & ~target};
-        if (p == piece::knight)
-            return {wk, wq, wr, wb, wn ^ move, wp,
-                    bk & ~target, bq & ~target, br & ~target, bb & ~target, bn & ~target, bp & ~target};
-        if (p == piece::pawn)
-            return {wk, wq, wr, wb, wn, wp ^ move,
-                    bk & ~target, bq & ~target, br & ~target, bb & ~target, bn & ~target, bp & ~target};
-        if (p == piece::none)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk & ~target, bq & ~target, br & ~target, bb & ~target, bn & ~target, bp & ~target};
+    const t_move *data() const {
+        return _moves;
+    }
+
+    t_move *begin() {
+        return _moves;
     }
-}
 
+    t_move *end() {
+        return _moves + _size;
+    }
 
-template <piece p, bool color>
-inline static t_board placePiece(t_board currentBoard, uint64_t target) {
-    uint64_t wk = currentBoard.whiteKing;
-    uint64_t wq = currentBoard.whiteQueen;
-    uint64_t wr = currentBoard.whiteRook;
-    uint64_t wb = currentBoard.whiteBishop;
-    uint64_t wn = currentBoard.whiteKnight;
-    uint64_t wp = currentBoard.whitePawn;
+    const t_move *begin() const {
+        return _moves;
+    }
 
-    uint64_t bk = currentBoard.blackKing;
-    uint64_t bq = currentBoard.blackQueen;
-    uint64_t br = currentBoard.blackRook;
-    uint64_t bb = currentBoard.blackBishop;
-    uint64_t bn = currentBoard.blackKnight;
-    uint64_t bp = currentBoard.blackPawn;
+    const t_move *end() const {
+        return _moves + _size;
+    }
 
-    if (color) {
-        // Black is moving
-
-        if (p == piece::king)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk | target, bq, br, bb, bn, bp};
-        if (p == piece::queen)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk, bq | target, br, bb, bn, bp};
-        if (p == piece::rook)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk, bq, br | target, bb, bn, bp};
-        if (p == piece::bishop)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk, bq, br, bb | target, bn, bp};
-        if (p == piece::knight)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk, bq, br, bb, bn | target, bp};
-        if (p == piece::pawn)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk, bq, br, bb, bn, bp | target};
-        if (p == piece::none)
-            return {wk, wq, wr, wb, wn, wp,
-                    bk, bq, br, bb, bn, bp};
-    } else {
-        // White is moving
-
-        if (p == piece::king)
-            return {wk | target, wq, wr, wb, wk, wp,
-                    bk, bq, br, bb, bn, bp};
-        if (p == piece::queen)
-            return {wk, wq | target, wr, wb, wk, wp,
-                    bk, bq, br, bb, bn, bp};
-        if (p == piece::rook)
-            return {wk, wq, wr | target, wb, wk, wp,
-                    bk, bq, br, bb, bn, bp};
-        if (p == piece::bishop)
-            return {wk, wq, wr, wb | target, wk, wp,
-                    bk, bq, br, bb, bn, bp};
-        if (p == piece::knight)
-            return {wk, wq, wr, wb, wk | target, wp,
-                    bk, bq, br, bb, bn, bp};
-        if (p == piece::pawn)
-            return {wk, wq, wr, wb, wk, wp | target,
-                    bk, bq, br, bb, bn, bp};
-        if (p == piece::none)
-            return {wk, wq, wr, wb, wk, wp,
-                    bk, bq, br, bb, bn, bp};
+    t_move &operator[](int index) {
+        return _moves[index];
     }
-}
 
+    const t_move &operator[](int index) const {
+        return _moves[index];
+    }
 
-template<bool color>
-inline static void moveKing(std::vector<t_gameState> *moves, t_gameState currentState, uint64_t origin, uint64_t targets) {
-    unsigned wCastleShort, wCastleLong, bCastleShort, bCastleLong;
-    if (color) {
-        wCastleShort = currentState.wCastleShort;
-        wCastleLong = currentState.wCastleLong;
+    t_move &at(int index) {
+        if (index < 0 || index >= _size) {
+            throw std::out_of_range("MoveList index out of range");
+        }
+        return _moves[index];
+    }
 
-        bCastleShort = false;
-        bCastleLong = false;
-    } else {
-        wCastleShort = false;
-        wCastleLong = false;
+    int size() const {
+        return _size;
+    }
 
-        bCastleShort = currentState.bCastleShort;
-        bCastleLong = currentState.bCastleLong;
+    bool empty() const {
+        return _size == 0;
     }
+};
 
-    uint64_t currentTarget;
-    while (targets != 0) {
-        currentTarget = (targets & -targets);
 
-        t_board targetBoard = move<piece::king, color>(currentState.board, origin, currentTarget);
-        t_move mov = t_move(origin, currentTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                wCastleShort, wCastleLong,
-                                bCastleShort, bCastleLong,
-                                0));
+/*
+ * Slider lookup indexing
+ * The lookup tables are indexed by the occupied squares of the move map, packed into the low bits in ascending square
+ * order (the inverse of occFromIndex). That is exactly what the BMI2 instruction PEXT does in a single instruction, so
+ * CPUs supporting it use those tables. All other CPUs fall back to magic multiplication on a second set of tables.
+ * Both sets are generated at compile time (see moveMaps.cpp), the variant is picked at runtime unless the build
+ * already targets BMI2.
+ */
 
-        targets &= (targets - 1);
-    }
+#ifdef SLIDER_LOOKUP_PEXT
+inline static uint16_t pextIdentifier(const uint64_t moveMap, const uint64_t occ) {
+    // Inline assembly instead of _pext_u64, so the call can be inlined without compiling everything for BMI2
+    uint64_t occId;
+    asm("pextq %2, %1, %0" : "=r"(occId) : "r"(occ), "r"(moveMap));
+    return (uint16_t) occId;
 }
+#endif
 
 
-template<bool color>
-inline static void moveKingCastleShort(std::vector<t_gameState> *moves, t_gameState currentState) {
-    unsigned wCastleShort, wCastleLong, bCastleShort, bCastleLong;
-    if (color) {
-        wCastleShort = currentState.wCastleShort;
-        wCastleLong = currentState.wCastleLong;
+inline static uint16_t magicIdentifier(const uint64_t moveMap, const uint64_t magic, const uint8_t shift, const uint64_t occ) {
+    return (uint16_t) (((occ & moveMap) * magic) >> shift);
+}
 
-        bCastleShort = false;
-        bCastleLong = false;
 
-        uint64_t kingOrigin = currentState.board.blackKing;
-        uint64_t kingTarget = kingOrigin << 2;
+inline bool initSliderLookup() {
+#if defined(__BMI2__)
+    return true;
+#else
+#ifdef SLIDER_LOOKUP_PEXT
+    __builtin_cpu_init();
+
+    // Zen 1 and Zen 2 implement PEXT in microcode, which is slower than the magic multiplication
+    if (__builtin_cpu_supports("bmi2") && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2")) {
+        return true;
+    }
+#endif
+
+    return false;
+#endif
+}
+
+// Selected once during static initialization
+inline const bool sliderLookupPext = initSliderLookup();
 
-        uint64_t rookOrigin = 0b0000000000000000000000000000000000000000000000000000000010000000;
-        uint64_t rookTarget = 0b0000000000000000000000000000000000000000000000000000000000100000;
 
-        t_board targetBoardKingMoved = move<piece::king, color>(currentState.board, kingOrigin, kingTarget);
-        t_board targetBoard = move<piece::rook, color>(targetBoardKingMoved, rookOrigin, rookTarget);
-        t_move mov = t_move(kingOrigin, kingTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                   wCastleShort, wCastleLong,
-                                   bCastleShort, bCastleLong,
-                                   0));
+template<piece p, bool pin>
+inline static uint64_t lookupSliderRays(const uint8_t piecePosition, const uint64_t occ) {
+    // Lookup for a single slider type (rook or bishop), either regular or ignoring the first obstruction (pin)
+    const uint64_t moveMap = p == piece::rook ? rookMoves[piecePosition] : bishopMoves[piecePosition];
+    const uint32_t offset = p == piece::rook ? rookLookupOffset[piecePosition] : bishopLookupOffset[piecePosition];
+
+#ifdef SLIDER_LOOKUP_PEXT
+    const uint64_t *lookupTable;
+    if constexpr (p == piece::rook) {
+        lookupTable = pin ? rookPinLookup.data() : rookLookup.data();
     } else {
-        wCastleShort = false;
-        wCastleLong = false;
+        lookupTable = pin ? bishopPinLookup.data() : bishopLookup.data();
+    }
+#endif
+
+#if defined(__BMI2__)
+    return lookupTable[offset + _pext_u64(occ, moveMap)];
+#else
+#ifdef SLIDER_LOOKUP_PEXT
+    if (sliderLookupPext) {
+        return lookupTable[offset + pextIdentifier(moveMap, occ)];
+    }
+#endif
 
-        bCastleShort = currentState.bCastleShort;
-        bCastleLong = currentState.bCastleLong;
+    const uint64_t *magicLookupTable;
+    uint16_t magicId;
+    if constexpr (p == piece::rook) {
+        magicLookupTable = pin ? rookPinMagicLookup.data() : rookMagicLookup.data();
+        magicId = magicIdentifier(moveMap, rookMagics[piecePosition], rookMagicShift[piecePosition], occ);
+    } else {
+        magicLookupTable = pin ? bishopPinMagicLookup.data() : bishopMagicLookup.data();
+        magicId = magicIdentifier(moveMap, bishopMagics[piecePosition], bishopMagicShift[piecePosition], occ);
+    }
 
-        uint64_t kingOrigin = currentState.board.whiteKing;
-        uint64_t kingTarget = kingOrigin << 2;
+    return magicLookupTable[offset + magicId];
+#endif
+}
 
-        uint64_t rookOrigin = 0b1000000000000000000000000000000000000000000000000000000000000000;
-        uint64_t rookTarget = 0b0010000000000000000000000000000000000000000000000000000000000000;
 
-        t_board targetBoardKingMoved = move<piece::king, color>(currentState.board, kingOrigin, kingTarget);
-        t_board targetBoard = move<piece::rook, color>(targetBoardKingMoved, rookOrigin, rookTarget);
-        t_move mov = t_move(kingOrigin, kingTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                   wCastleShort, wCastleLong,
-                                   bCastleShort, bCastleLong,
-                                   0));
+template<bool color>
+inline static piece pieceAt(const t_board &board, uint8_t shift) {
+    // Piece type of color occupying the given square, none if there is no such piece
+    uint8_t entry = board.pieceOn[shift];
+    if (color ? entry < MAILBOX_BLACK || entry == MAILBOX_EMPTY : entry >= MAILBOX_BLACK) {
+        return piece::none;
     }
+    return mailboxPiece(entry);
 }
 
 
 template<bool color>
-inline static void moveKingCastleLong(std::vector<t_gameState> *moves, t_gameState currentState) {
-    unsigned wCastleShort, wCastleLong, bCastleShort, bCastleLong;
+inline static void togglePiece(t_board &board, piece p, uint64_t squares) {
+    /* Flip the given squares in the bitboard of piece p and in the color bitboard, in place
+     * Toggling origin | target moves a piece, toggling a single square adds or removes it.
+     * The occupied bitboard is left to the caller, so it is rebuilt once per move.
+     */
     if (color) {
-        wCastleShort = currentState.wCastleShort;
-        wCastleLong = currentState.wCastleLong;
+        switch (p) {
+            case piece::king: board.blackKing ^= squares; break;
+            case piece::queen: board.blackQueen ^= squares; break;
+            case piece::rook: board.blackRook ^= squares; break;
+            case piece::bishop: board.blackBishop ^= squares; break;
+            case piece::knight: board.blackKnight ^= squares; break;
+            case piece::pawn: board.blackPawn ^= squares; break;
+            case piece::none: return;
+        }
+        board.black ^= squares;
+    } else {
+        switch (p) {
+            case piece::king: board.whiteKing ^= squares; break;
+            case piece::queen: board.whiteQueen ^= squares; break;
+            case piece::rook: board.whiteRook ^= squares; break;
+            case piece::bishop: board.whiteBishop ^= squares; break;
+            case piece::knight: board.whiteKnight ^= squares; break;
+            case piece::pawn: board.whitePawn ^= squares; break;
+            case piece::none: return;
+        }
+        board.white ^= squares;
+    }
+}
 
-        bCastleShort = false;
-        bCastleLong = false;
 
-        uint64_t kingOrigin = currentState.board.blackKing;
-        uint64_t kingTarget = kingOrigin >> 2;
+/*
+ * Move visitors
+ * generate_moves hands its moves to a visitor in groups, as they fall out of the bitboard operations. A visitor
+ * provides the member functions below and decides what to do with each group, so the generator never commits to
+ * an output format:
+ *  piece(originShift, targets, enemy): One origin to every target
+ *  castleShort(kingShift), castleLong(kingShift): Castling of the king on kingShift
+ *  pawns(origins, targets, enemy): Origins and targets are matched pairwise from the lowest bit upwards
+ *  pawnsPromotion(origins, targets, enemy): As pawns, each pair promoting to queen, rook, bishop and knight
+ *  pawnsPush(origins, targets): As pawns, for double pushes
+ *  pawnsEnPassant(origins, target): Every origin takes en passant onto target
+ */
 
-        uint64_t rookOrigin = 0b0000000000000000000000000000000000000000000000000000000000000001;
-        uint64_t rookTarget = 0b0000000000000000000000000000000000000000000000000000000000001000;
+typedef struct moveListVisitor {
+    // Writes every move into a move list
+    MoveList *moves;
 
-        t_board targetBoardKingMoved = move<piece::king, color>(currentState.board, kingOrigin, kingTarget);
-        t_board targetBoard = move<piece::rook, color>(targetBoardKingMoved, rookOrigin, rookTarget);
-        t_move mov = t_move(kingOrigin, kingTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                   wCastleShort, wCastleLong,
-                                   bCastleShort, bCastleLong,
-                                   0));
-    } else {
-        wCastleShort = false;
-        wCastleLong = false;
+    explicit moveListVisitor(MoveList *moveList) : moves(moveList) {}
 
-        bCastleShort = currentState.bCastleShort;
-        bCastleLong = currentState.bCastleLong;
+    void piece(uint8_t originShift, uint64_t targets, uint64_t enemy) {
+        // Captures are flagged for move ordering
+        uint8_t targetShift;
+        while (targets != 0) {
+            targetShift = findFirst(targets);
 
-        uint64_t kingOrigin = currentState.board.whiteKing;
-        uint64_t kingTarget = kingOrigin >> 2;
+            uint8_t flags = (enemy & ((uint64_t) 1 << targetShift)) != 0 ? MOVE_FLAG_CAPTURE : MOVE_FLAG_QUIET;
+            moves->emplace_back(originShift, targetShift, flags);
 
-        uint64_t rookOrigin = 0b0000000100000000000000000000000000000000000000000000000000000000;
-        uint64_t rookTarget = 0b0000100000000000000000000000000000000000000000000000000000000000;
-
-        t_board targetBoardKingMoved = move<piece::king, color>(currentState.board, kingOrigin, kingTarget);
-        t_board targetBoard = move<piece::rook, color>(targetBoardKingMoved, rookOrigin, rookTarget);
-        t_move mov = t_move(kingOrigin, kingTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                   wCastleShort, wCastleLong,
-                                   bCastleShort, bCastleLong,
-                                   0));
+            targets = clearFirst(targets);
+        }
     }
-}
 
+    void castleShort(uint8_t kingShift) {
+        moves->emplace_back(kingShift, kingShift + 2, MOVE_FLAG_CASTLE_SHORT);
+    }
 
-template<bool color>
-inline static void moveQueens(std::vector<t_gameState> *moves, t_gameState currentState, uint8_t originShift, uint64_t targets) {
-    uint64_t origin = (uint64_t )1 << originShift;
+    void castleLong(uint8_t kingShift) {
+        moves->emplace_back(kingShift, kingShift - 2, MOVE_FLAG_CASTLE_LONG);
+    }
 
-    uint64_t currentTarget;
-    while (targets != 0) {
-        currentTarget = (targets & -targets);
+    void pawns(uint64_t origins, uint64_t targets, uint64_t enemy) {
+        uint8_t currentOrigin, currentTarget;
+        while (targets != 0) {
+            currentOrigin = findFirst(origins);
+            currentTarget = findFirst(targets);
 
-        t_board targetBoard = move<piece::queen, color>(currentState.board, origin, currentTarget);
-        t_move mov = t_move(origin, currentTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                   currentState.wCastleShort, currentState.wCastleLong,
-                                   currentState.bCastleShort, currentState.bCastleLong,
-                                0));
+            uint8_t flags = (enemy & ((uint64_t) 1 << currentTarget)) != 0 ? MOVE_FLAG_CAPTURE : MOVE_FLAG_QUIET;
+            moves->emplace_back(currentOrigin, currentTarget, flags);
 
-        targets &= (targets - 1);
+            origins = clearFirst(origins);
+            targets = clearFirst(targets);
+        }
     }
-}
 
+    void pawnsPromotion(uint64_t origins, uint64_t targets, uint64_t enemy) {
+        uint8_t currentOrigin, currentTarget;
+        while (targets != 0) {
+            currentOrigin = findFirst(origins);
+            currentTarget = findFirst(targets);
 
-template<bool color>
-inline static void moveRooks(std::vector<t_gameState> *moves, t_gameState currentState, uint8_t originShift, uint64_t targets) {
-    uint64_t origin = (uint64_t )1 << originShift;
-
-    unsigned wCastleShort, wCastleLong, bCastleShort, bCastleLong;
-    if (color) {
-        wCastleShort = currentState.wCastleShort;
-        wCastleLong = currentState.wCastleLong;
+            uint8_t flags = MOVE_FLAG_PROMOTION;
+            if ((enemy & ((uint64_t) 1 << currentTarget)) != 0) {
+                flags |= MOVE_FLAG_CAPTURE;
+            }
 
-        bCastleShort = originShift != 7;
-        bCastleLong = originShift != 0;
-    } else {
-        wCastleShort = originShift != 63;
-        wCastleLong = originShift != 56;
+            moves->emplace_back(currentOrigin, currentTarget, flags | MOVE_PROMOTION_QUEEN);
+            moves->emplace_back(currentOrigin, currentTarget, flags | MOVE_PROMOTION_ROOK);
+            moves->emplace_back(currentOrigin, currentTarget, flags | MOVE_PROMOTION_BISHOP);
+            moves->emplace_back(currentOrigin, currentTarget, flags | MOVE_PROMOTION_KNIGHT);
 
-        bCastleShort = currentState.bCastleShort;
-        bCastleLong = currentState.bCastleLong;
+            origins = clearFirst(origins);
+            targets = clearFirst(targets);
+        }
     }
 
-    uint64_t currentTarget;
-    while (targets != 0) {
-        currentTarget = (targets & -targets);
+    void pawnsPush(uint64_t origins, uint64_t targets) {
+        uint8_t currentOrigin, currentTarget;
+        while (targets != 0) {
+            currentOrigin = findFirst(origins);
+            currentTarget = findFirst(targets);
 
-        t_board targetBoard = move<piece::rook, color>(currentState.board, origin, currentTarget);
-        t_move mov = t_move(origin, currentTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                wCastleShort, wCastleLong,
-                                bCastleShort, bCastleLong,
-                                0));
+            moves->emplace_back(currentOrigin, currentTarget, MOVE_FLAG_DOUBLE_PUSH);
 
-        targets &= (targets - 1);
+            origins = clearFirst(origins);
+            targets = clearFirst(targets);
+        }
     }
-}
 
+    void pawnsEnPassant(uint64_t origins, uint64_t target) {
+        if (target == 0) {
+            return;
+        }
 
-template<bool color>
-inline static void moveBishops(std::vector<t_gameState> *moves, t_gameState currentState, uint8_t originShift, uint64_t targets) {
-    uint64_t origin = (uint64_t )1 << originShift;
+        uint8_t targetShift = findFirst(target);
+        while (origins != 0) {
+            moves->emplace_back(findFirst(origins), targetShift, MOVE_FLAG_EN_PASSANT);
+
+            origins = clearFirst(origins);
+        }
+    }
+} t_moveListVisitor;
 
-    uint64_t currentTarget;
-    while (targets != 0) {
-        currentTarget = (targets & -targets);
 
-        t_board targetBoard = move<piece::bishop, color>(currentState.board, origin, currentTarget);
-        t_move mov = t_move(origin, currentTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                   currentState.wCastleShort, currentState.wCastleLong,
-                                   currentState.bCastleShort, currentState.bCastleLong,
-                                0));
+typedef struct moveCountVisitor {
+    // Only counts the moves, using popcount on the target sets instead of visiting single moves
+    uint64_t count = 0;
 
-        targets &= (targets - 1);
+    void piece([[maybe_unused]] uint8_t originShift, uint64_t targets, [[maybe_unused]] uint64_t enemy) {
+        count += countFigure(targets);
     }
-}
 
+    void castleShort([[maybe_unused]] uint8_t kingShift) {
+        count++;
+    }
 
-template<bool color>
-inline static void moveKnights(std::vector<t_gameState> *moves, t_gameState currentState, uint8_t originShift, uint64_t targets) {
-    uint64_t origin = (uint64_t )1 << originShift;
+    void castleLong([[maybe_unused]] uint8_t kingShift) {
+        count++;
+    }
 
-    uint64_t currentTarget;
-    while (targets != 0) {
-        currentTarget = (targets & -targets);
+    void pawns([[maybe_unused]] uint64_t origins, uint64_t targets, [[maybe_unused]] uint64_t enemy) {
+        count += countFigure(targets);
+    }
 
-        t_board targetBoard = move<piece::knight, color>(currentState.board, origin, currentTarget);
-        t_move mov = t_move(origin, currentTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                   currentState.wCastleShort, currentState.wCastleLong,
-                                   currentState.bCastleShort, currentState.bCastleLong,
-                                0));
+    void pawnsPromotion([[maybe_unused]] uint64_t origins, uint64_t targets, [[maybe_unused]] uint64_t enemy) {
+        count += 4 * countFigure(targets);
+    }
 
-        targets &= (targets - 1);
+    void pawnsPush([[maybe_unused]] uint64_t origins, uint64_t targets) {
+        count += countFigure(targets);
     }
-}
 
+    void pawnsEnPassant(uint64_t origins, uint64_t target) {
+        if (target != 0) {
+            count += countFigure(origins);
+        }
+    }
+} t_moveCountVisitor;
 
-template<bool color>
-inline static void movePawns(std::vector<t_gameState> *moves, t_gameState currentState, uint64_t origins, uint64_t targets) {
-    // TODO: Handle promotions
 
-    uint64_t currentOrigin, currentTarget;
-    while (targets != 0) {
-        currentOrigin = (origins & -origins);
-        currentTarget = (targets & -targets);
+/*
+ * Undo record
+ * Everything makeMove overwrites that can't be recovered from the move itself. One record is kept per ply, so
+ * taking a move back restores the previous state without keeping a copy of it.
+ */
 
-        t_board targetBoard = move<piece::pawn, color>(currentState.board, currentOrigin, currentTarget);
-        t_move mov = t_move(currentOrigin, currentTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                currentState.wCastleShort, currentState.wCastleLong,
-                                currentState.bCastleShort, currentState.bCastleLong,
-                                0));
+typedef struct undo {
+    t_move move;  // Move that led to the state before makeMove
+    piece captured;
 
-        origins &= (origins - 1);
-        targets &= (targets - 1);
-    }
-}
+    unsigned wCastleShort: 1;
+    unsigned wCastleLong: 1;
+    unsigned bCastleShort: 1;
+    unsigned bCastleLong: 1;
 
+    unsigned enpassant: 4;
 
-template<bool color>
-inline static void movePawnsPromotion(std::vector<t_gameState> *moves, t_gameState currentState, uint64_t origins, uint64_t targets) {
-    uint64_t currentOrigin, currentTarget;
-    while (targets != 0) {
-        currentOrigin = (origins & -origins);
-        currentTarget = (targets & -targets);
+    uint64_t hash;  // Position hash before makeMove
+} t_undo;
 
-        t_board targetBoardPrePromotion = move<piece::pawn, color>(currentState.board, currentOrigin, currentTarget);
 
-        {
-            // Promote to queen
-            t_board targetBoardPieceRemoved = move<piece::none, !color>(targetBoardPrePromotion, 0, currentTarget);
-            t_board targetBoard = placePiece<piece::queen, color>(targetBoardPieceRemoved, currentTarget);
-
-            t_move mov = t_move(currentOrigin, currentTarget);
-            moves->push_back(gameState(targetBoard, mov,
-                                       currentState.wCastleShort, currentState.wCastleLong,
-                                       currentState.bCastleShort, currentState.bCastleLong,
-                                       0));
-        }
-        {
-            // Promote to rook
-            t_board targetBoardPieceRemoved = move<piece::none, !color>(targetBoardPrePromotion, 0, currentTarget);
-            t_board targetBoard = placePiece<piece::rook, color>(targetBoardPieceRemoved, currentTarget);
-
-            t_move mov = t_move(currentOrigin, currentTarget);
-            moves->push_back(gameState(targetBoard, mov,
-                                       currentState.wCastleShort, currentState.wCastleLong,
-                                       currentState.bCastleShort, currentState.bCastleLong,
-                                       0));
-        }
-        {
-            // Promote to bishop
-            t_board targetBoardPieceRemoved = move<piece::none, !color>(targetBoardPrePromotion, 0, currentTarget);
-            t_board targetBoard = placePiece<piece::bishop, color>(targetBoardPieceRemoved, currentTarget);
-
-            t_move mov = t_move(currentOrigin, currentTarget);
-            moves->push_back(gameState(targetBoard, mov,
-                                       currentState.wCastleShort, currentState.wCastleLong,
-                                       currentState.bCastleShort, currentState.bCastleLong,
-                                       0));
-        }
-        {
-            // Promote to knight
-            t_board targetBoardPieceRemoved = move<piece::none, !color>(targetBoardPrePromotion, 0, currentTarget);
-            t_board targetBoard = placePiece<piece::knight, color>(targetBoardPieceRemoved, currentTarget);
-
-            t_move mov = t_move(currentOrigin, currentTarget);
-            moves->push_back(gameState(targetBoard, mov,
-                                       currentState.wCastleShort, currentState.wCastleLong,
-                                       currentState.bCastleShort, currentState.bCastleLong,
-                                       0));
-        }
-
-        origins &= (origins - 1);
-        targets &= (targets - 1);
+inline static void castleRookSquares(bool color, uint8_t flags, uint64_t *rookOrigin, uint64_t *rookTarget) {
+    // The rooks always castle from and to fixed squares
+    if (flags == MOVE_FLAG_CASTLE_SHORT) {
+        *rookOrigin = color ? (uint64_t) 1 << 7 : (uint64_t) 1 << 63;
+        *rookTarget = color ? (uint64_t) 1 << 5 : (uint64_t) 1 << 61;
+    } else {
+        *rookOrigin = color ? (uint64_t) 1 << 0 : (uint64_t) 1 << 56;
+        *rookTarget = color ? (uint64_t) 1 << 3 : (uint64_t) 1 << 59;
     }
 }
 
 
-template <bool color>
-inline static void movePawnsPush(std::vector<t_gameState> *moves, t_gameState currentState, uint64_t origins, uint64_t targets) {
-    uint8_t currentFile;
-    uint64_t currentOrigin, currentTarget;
-    while (targets != 0) {
-        currentOrigin = (origins & -origins);
-        currentTarget = (targets & -targets);
+template<bool color>
+inline static uint64_t updateHash(uint64_t hash, const t_gameState &state, const t_undo &undo) {
+    /* Hash of state, derived from the hash before the last move instead of hashing the whole board again
+     * Arguments:
+     *  hash: Hash before the move
+     *  state: State right after the move was played on it by makeMove<color>
+     *  undo: Record filled by that makeMove call
+     */
+
+    const t_board &board = state.board;
+    const t_move mov = state.move;
+    uint8_t origin = mov.origin();
+    uint8_t target = mov.target();
+
+    // The moved piece now stands on the target square
+    uint8_t moved = board.pieceOn[target];
+
+    uint8_t flags = mov.flags();
+    if (flags == MOVE_FLAG_CASTLE_SHORT || flags == MOVE_FLAG_CASTLE_LONG) {
+        uint64_t rookOrigin, rookTarget;
+        castleRookSquares(color, flags, &rookOrigin, &rookTarget);
+
+        uint8_t rook = mailboxEntry(color, piece::rook);
+        hash ^= hashPiece(origin, moved) ^ hashPiece(target, moved);
+        hash ^= hashPiece(findFirst(rookOrigin), rook) ^ hashPiece(findFirst(rookTarget), rook);
+    } else {
+        if (undo.captured != piece::none) {
+            uint8_t capturedShift = flags == MOVE_FLAG_EN_PASSANT ? (color ? target - 8 : target + 8) : target;
+            hash ^= hashPiece(capturedShift, mailboxEntry(!color, undo.captured));
+        }
+
+        uint8_t before = mov.isPromotion() ? mailboxEntry(color, piece::pawn) : moved;
+        hash ^= hashPiece(origin, before) ^ hashPiece(target, moved);
+    }
 
-        currentFile = findFirst(currentOrigin) % 8;
+    hash ^= hashStats(undo.wCastleShort, undo.wCastleLong, undo.bCastleShort, undo.bCastleLong, undo.enpassant);
+    hash ^= hashStats(state.wCastleShort, state.wCastleLong, state.bCastleShort, state.bCastleLong, state.enpassant);
 
-        t_board targetBoard = move<piece::pawn, color>(currentState.board, currentOrigin, currentTarget);
-        t_move mov = t_move(currentOrigin, currentTarget);
-        moves->push_back(gameState(targetBoard, mov,
-                                currentState.wCastleShort, currentState.wCastleLong,
-                                currentState.bCastleShort, currentState.bCastleLong,
-                                currentFile));
+    // The side to move changes with every move
+    hash ^= hashKeys[HASH_SIDE_KEY];
 
-        origins &= (origins - 1);
-        targets &= (targets - 1);
-    }
+    return hash;
 }
 
 
-template <bool color>
-inline static void movePawnsEnPassant(std::vector<t_gameState> *moves, t_gameState currentState, uint64_t origins, uint64_t target) {
-    uint64_t targetPawn;
-    if (color) {
-        targetPawn = target >> 8;
+template<bool color>
+inline static void makeMove(t_gameState &state, const t_move mov, t_undo *undo) {
+    /* Play mov on state in place, only touching the affected bitboards
+     * Arguments:
+     *  state: State before the move, with color to move
+     *  mov: Move generated by generate_moves<color> for state
+     *  undo: Record receiving what unmakeMove<color> needs to take the move back
+     */
+
+    t_board &board = state.board;
+    uint64_t origin = mov.originMap();
+    uint64_t target = mov.targetMap();
+
+    undo->move = state.move;
+    undo->captured = piece::none;
+    undo->wCastleShort = state.wCastleShort;
+    undo->wCastleLong = state.wCastleLong;
+    undo->bCastleShort = state.bCastleShort;
+    undo->bCastleLong = state.bCastleLong;
+    undo->enpassant = state.enpassant;
+    undo->hash = state.hash;
+
+    state.move = mov;
+    state.enpassant = 0;
+
+    bool kingMoved = false;
+
+    uint8_t flags = mov.flags();
+    if (flags == MOVE_FLAG_CASTLE_SHORT || flags == MOVE_FLAG_CASTLE_LONG) {
+        uint64_t rookOrigin, rookTarget;
+        castleRookSquares(color, flags, &rookOrigin, &rookTarget);
+
+        togglePiece<color>(board, piece::king, origin | target);
+        togglePiece<color>(board, piece::rook, rookOrigin | rookTarget);
+        board.pieceOn[mov.target()] = board.pieceOn[mov.origin()];
+        board.pieceOn[findFirst(rookTarget)] = board.pieceOn[findFirst(rookOrigin)];
+        board.pieceOn[mov.origin()] = MAILBOX_EMPTY;
+        board.pieceOn[findFirst(rookOrigin)] = MAILBOX_EMPTY;
+        kingMoved = true;
+    } else if (flags == MOVE_FLAG_EN_PASSANT) {
+        // Only take a pawn that is actually there, so a stale en passant file can't create one
+        uint64_t takenPawn = (color ? target >> 8 : target << 8) & (color ? board.whitePawn : board.blackPawn);
+        undo->captured = takenPawn != 0 ? piece::pawn : piece::none;
+
+        togglePiece<color>(board, piece::pawn, origin | target);
+        togglePiece<!color>(board, undo->captured, takenPawn);
+        board.pieceOn[mov.target()] = board.pieceOn[mov.origin()];
+        board.pieceOn[mov.origin()] = MAILBOX_EMPTY;
+        if (takenPawn != 0) {
+            board.pieceOn[color ? mov.target() - 8 : mov.target() + 8] = MAILBOX_EMPTY;
+        }
     } else {
-        targetPawn = target << 8;
-    }
-
-    uint64_t currentOrigin;
-    while (origins != 0) {
-        currentOrigin = (origins & -origins);
+        if (mov.isCapture()) {
+            undo->captured = pieceAt<!color>(board, mov.target());
+            togglePiece<!color>(board, undo->captured, target);
+        }
 
-        t_board targetBoardPreTake = move<piece::pawn, color>(currentState.board, currentOrigin, target);
-        t_board targetBoard = move<piece::none, color>(targetBoardPreTake, 0, targetPawn);
-        t_move mov = t_move(currentOrigin, target);
-        moves->push_back(gameState(targetBoard, mov,
-                                currentState.wCastleShort, currentState.wCastleLong,
-                                currentState.bCastleShort, currentState.wCastleLong,
-                                0));
+        if (mov.isPromotion()) {
+            togglePiece<color>(board, piece::pawn, origin);
+            togglePiece<color>(board, mov.promotion(), target);
+            board.pieceOn[mov.target()] = mailboxEntry(color, mov.promotion());
+            board.pieceOn[mov.origin()] = MAILBOX_EMPTY;
+        } else {
+            piece moving = mailboxPiece(board.pieceOn[mov.origin()]);
+            togglePiece<color>(board, moving, origin | target);
+            board.pieceOn[mov.target()] = board.pieceOn[mov.origin()];
+            board.pieceOn[mov.origin()] = MAILBOX_EMPTY;
+
+            if (moving == piece::rook) {
+                // Moving a rook off its corner disables castling to that side
+                if (color) {
+                    state.bCastleShort = state.bCastleShort && mov.origin() != 7;
+                    state.bCastleLong = state.bCastleLong && mov.origin() != 0;
+                } else {
+                    state.wCastleShort = state.wCastleShort && mov.origin() != 63;
+                    state.wCastleLong = state.wCastleLong && mov.origin() != 56;
+                }
+            } else if (moving == piece::king) {
+                kingMoved = true;
+            } else if (flags == MOVE_FLAG_DOUBLE_PUSH) {
+                state.enpassant = mov.origin() % 8 + 1;
+            }
+        }
+    }
 
-        origins &= (origins - 1);
+    if (kingMoved) {
+        // Any king move, castling included, gives up castling to both sides
+        if (color) {
+            state.bCastleShort = false;
+            state.bCastleLong = false;
+        } else {
+            state.wCastleShort = false;
+            state.wCastleLong = false;
+        }
     }
+
+    board.occupied = board.white | board.black;
+    state.hash = updateHash<color>(undo->hash, state, *undo);
 }
 
 
-// TODO: Move function for castles
+template<bool color>
+inline static void unmakeMove(t_gameState &state, const t_undo &undo) {
+    /* Take back the last move of state, which was played by color through makeMove<color>
+     * Arguments:
+     *  state: State after the move, restored in place
+     *  undo: Record filled by the matching makeMove call
+     */
+
+    t_board &board = state.board;
+    const t_move mov = state.move;
+    uint64_t origin = mov.originMap();
+    uint64_t target = mov.targetMap();
+
+    uint8_t flags = mov.flags();
+    if (flags == MOVE_FLAG_CASTLE_SHORT || flags == MOVE_FLAG_CASTLE_LONG) {
+        uint64_t rookOrigin, rookTarget;
+        castleRookSquares(color, flags, &rookOrigin, &rookTarget);
+
+        togglePiece<color>(board, piece::king, origin | target);
+        togglePiece<color>(board, piece::rook, rookOrigin | rookTarget);
+        board.pieceOn[mov.origin()] = board.pieceOn[mov.target()];
+        board.pieceOn[findFirst(rookOrigin)] = board.pieceOn[findFirst(rookTarget)];
+        board.pieceOn[mov.target()] = MAILBOX_EMPTY;
+        board.pieceOn[findFirst(rookTarget)] = MAILBOX_EMPTY;
+    } else if (flags == MOVE_FLAG_EN_PASSANT) {
+        togglePiece<color>(board, piece::pawn, origin | target);
+        togglePiece<!color>(board, undo.captured, color ? target >> 8 : target << 8);
+        board.pieceOn[mov.origin()] = board.pieceOn[mov.target()];
+        board.pieceOn[mov.target()] = MAILBOX_EMPTY;
+        board.pieceOn[color ? mov.target() - 8 : mov.target() + 8] = mailboxEntry(!color, undo.captured);
+    } else {
+        if (mov.isPromotion()) {
+            togglePiece<color>(board, mov.promotion(), target);
+            togglePiece<color>(board, piece::pawn, origin);
+            board.pieceOn[mov.origin()] = mailboxEntry(color, piece::pawn);
+        } else {
+            togglePiece<color>(board, mailboxPiece(board.pieceOn[mov.target()]), origin | target);
+            board.pieceOn[mov.origin()] = board.pieceOn[mov.target()];
+        }
 
+        togglePiece<!color>(board, undo.captured, target);
+        board.pieceOn[mov.target()] = mailboxEntry(!color, undo.captured);
+    }
 
+    board.occupied = board.white | board.black;
 
+    state.move = undo.move;
+    state.wCastleShort = undo.wCastleShort;
+    state.wCastleLong = undo.wCastleLong;
+    state.bCastleShort = undo.bCastleShort;
+    state.bCastleLong = undo.bCastleLong;
+    state.enpassant = undo.enpassant;
+    state.hash = undo.hash;
+}
 
 
+template<bool color>
+inline static t_gameState applyMove(const t_gameState &currentState, const t_move mov) {
+    // Copy of the state reached by playing mov, for callers that need to keep the current state untouched
+    t_gameState nextState = currentState;
+    t_undo undo;
+    makeMove<color>(nextState, mov, &undo);
+    return nextState;
+}
+
 
 template<piece p>
 inline static uint64_t lookupSlider(const uint8_t piecePosition, const uint64_t occ) {
     switch (p) {
         case piece::rook: {
-            uint64_t moveMap = rookMoves[piecePosition];
-            uint16_t occId = occIdentifier(moveMap, occ);
-
-            return rookLookup[64 * occId + piecePosition];
+            return lookupSliderRays<piece::rook, false>(piecePosition, occ);
         }
         case piece::bishop: {
-            uint64_t moveMap = bishopMoves[piecePosition];
-            uint16_t occId = occIdentifier(moveMap, occ);
-
-            return bishopLookup[64 * occId + piecePosition];
+            return lookupSliderRays<piece::bishop, false>(piecePosition, occ);
         }
         case piece::queen: {
-            uint64_t rookMoveMap = rookMoves[piecePosition];
-            uint64_t bishopMoveMap = bishopMoves[piecePosition];
-
-            uint16_t rookOccId = occIdentifier(rookMoveMap, occ);
-            uint16_t bishopOccId = occIdentifier(bishopMoveMap, occ);
-
-            return rookLookup[64 * rookOccId + piecePosition] | bishopLookup[64 * bishopOccId + piecePosition];
+            return lookupSliderRays<piece::rook, false>(piecePosition, occ) |
+                   lookupSliderRays<piece::bishop, false>(piecePosition, occ);
         }
     }
 
@@ -638,25 +757,14 @@ template<piece p>
 inline static uint64_t lookupPinSlider(const uint8_t piecePosition, const uint64_t occ) {
     switch (p) {
         case piece::rook: {
-            uint64_t moveMap = rookMoves[piecePosition];
-            uint16_t occId = occIdentifier(moveMap, occ);
-
-            return rookPinLookup[64 * occId + piecePosition];
+            return lookupSliderRays<piece::rook, true>(piecePosition, occ);
         }
         case piece::bishop: {
-            uint64_t moveMap = bishopMoves[piecePosition];
-            uint16_t occId = occIdentifier(moveMap, occ);
-
-            return bishopPinLookup[64 * occId + piecePosition];
+            return lookupSliderRays<piece::bishop, true>(piecePosition, occ);
         }
         case piece::queen: {
-            uint64_t rookMoveMap = rookMoves[piecePosition];
-            uint64_t bishopMoveMap = bishopMoves[piecePosition];
-
-            uint16_t rookOccId = occIdentifier(rookMoveMap, occ);
-            uint16_t bishopOccId = occIdentifier(bishopMoveMap, occ);
-
-            return rookPinLookup[64 * rookOccId + piecePosition] | bishopPinLookup[64 * bishopOccId + piecePosition];
+            return lookupSliderRays<piece::rook, true>(piecePosition, occ) |
+                   lookupSliderRays<piece::bishop, true>(piecePosition, occ);
         }
     }
 
@@ -678,41 +786,104 @@ inline static uint64_t lookup(const uint8_t piecePosition) {
 }
 
 
-inline uint64_t getThreatenedWhite(const t_board board) {
-    uint64_t occ = board.occupied;
-    uint64_t threatened = 0;
+/*
+ * Setwise slider attacks
+ * All squares attacked by a set of sliders, without looking at them one by one. With AVX2 the sliders are spread with
+ * occluded Kogge-Stone fills: One vector holds the four directions shifting towards h1, a second one the opposite
+ * four, so all eight directions of all sliders are filled in three doubling steps. Without AVX2 the sliders are looked
+ * up one after another, which the lookup tables already do well.
+ */
 
-    // Add uint64_ts covered by the king
-    threatened |= lookup<piece::king>(findFirst(board.blackKing));
+#if defined(__x86_64__) || defined(_M_X64)
+#define SLIDER_FILL_AVX2
+#endif
+
+#ifdef SLIDER_FILL_AVX2
+__attribute__((target("avx2")))
+inline uint64_t sliderAttacksAvx2(const uint64_t lateralSliders, const uint64_t diagonalSliders, const uint64_t occ) {
+    // Lanes from low to high: east/west, south/north, southeast/northwest, southwest/northeast
+    const __m256i shifts = _mm256_set_epi64x(7, 9, 8, 1);
+    const __m256i leftMasks = _mm256_set_epi64x((long long) ~hFile, (long long) ~aFile, -1, (long long) ~aFile);
+    const __m256i rightMasks = _mm256_set_epi64x((long long) ~aFile, (long long) ~hFile, -1, (long long) ~hFile);
+
+    const __m256i sliders = _mm256_set_epi64x((long long) diagonalSliders, (long long) diagonalSliders,
+                                              (long long) lateralSliders, (long long) lateralSliders);
+    const __m256i empty = _mm256_set1_epi64x((long long) ~occ);
+
+    // Fill over empty squares only, the masks keep the fills from wrapping around the board edges
+    __m256i leftGen = sliders;
+    __m256i rightGen = sliders;
+    __m256i leftPro = _mm256_and_si256(empty, leftMasks);
+    __m256i rightPro = _mm256_and_si256(empty, rightMasks);
+    __m256i step = shifts;
+    for (int i = 0; i < 3; i++) {
+        leftGen = _mm256_or_si256(leftGen, _mm256_and_si256(leftPro, _mm256_sllv_epi64(leftGen, step)));
+        rightGen = _mm256_or_si256(rightGen, _mm256_and_si256(rightPro, _mm256_srlv_epi64(rightGen, step)));
+        leftPro = _mm256_and_si256(leftPro, _mm256_sllv_epi64(leftPro, step));
+        rightPro = _mm256_and_si256(rightPro, _mm256_srlv_epi64(rightPro, step));
+        step = _mm256_add_epi64(step, step);
+    }
 
-    // Add uint64_ts covered by the queens
-    uint64_t queens = board.blackQueen;
-    while (queens != 0) {
-        threatened |= lookupSlider<piece::queen>(findFirst(queens), occ);
+    // One more step onto the first obstruction in every direction
+    __m256i attacks = _mm256_or_si256(_mm256_and_si256(_mm256_sllv_epi64(leftGen, shifts), leftMasks),
+                                      _mm256_and_si256(_mm256_srlv_epi64(rightGen, shifts), rightMasks));
+    __m128i halves = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    return (uint64_t) (_mm_cvtsi128_si64(halves) | _mm_extract_epi64(halves, 1));
+}
+#endif
+
+
+inline bool initSliderFill() {
+#if defined(__AVX2__)
+    return true;
+#elif defined(SLIDER_FILL_AVX2)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
 
-        queens &= (queens - 1);
-    }
+// Selected once during static initialization
+inline const bool sliderFillAvx2 = initSliderFill();
 
-    // Add uint64_ts covered by the rooks
-    uint64_t rooks = board.blackRook;
-    while (rooks != 0) {
-        threatened |= lookupSlider<piece::rook>(findFirst(rooks), occ);
 
-        rooks &= (rooks - 1);
+inline uint64_t sliderAttacks(uint64_t lateralSliders, uint64_t diagonalSliders, const uint64_t occ) {
+    // Squares attacked by the given rooks (lateral) and bishops (diagonal), queens belong to both sets
+#ifdef SLIDER_FILL_AVX2
+    if (sliderFillAvx2) {
+        return sliderAttacksAvx2(lateralSliders, diagonalSliders, occ);
     }
+#endif
 
-    // Add uint64_ts covered by the bishops
-    uint64_t bishops = board.blackBishop;
-    while (bishops != 0) {
-        threatened |= lookupSlider<piece::bishop>(findFirst(bishops), occ);
-        bishops &= (bishops - 1);
+    uint64_t attacks = 0;
+    while (lateralSliders != 0) {
+        attacks |= lookupSlider<piece::rook>(findFirst(lateralSliders), occ);
+        lateralSliders = clearFirst(lateralSliders);
+    }
+    while (diagonalSliders != 0) {
+        attacks |= lookupSlider<piece::bishop>(findFirst(diagonalSliders), occ);
+        diagonalSliders = clearFirst(diagonalSliders);
     }
 
+    return attacks;
+}
+
+
+inline uint64_t getThreatenedWhite(const t_board &board, const uint64_t occ) {
+    uint64_t threatened = 0;
+
+    // Add uint64_ts covered by the king
+    threatened |= lookup<piece::king>(findFirst(board.blackKing));
+
+    // Add uint64_ts covered by the queens, rooks and bishops
+    threatened |= sliderAttacks(board.blackQueen | board.blackRook, board.blackQueen | board.blackBishop, occ);
+
     // Add uint64_ts covered by the knights
     uint64_t knights = board.blackKnight;
     while (knights != 0) {
         threatened |= lookup<piece::knight>(findFirst(knights));
-        knights &= (knights - 1);
+        knights = clearFirst(knights);
     }
 
     // Add uint64_ts covered by pawns
@@ -722,42 +893,25 @@ inline uint64_t getThreatenedWhite(const t_board board) {
     return threatened;
 }
 
+inline uint64_t getThreatenedWhite(const t_board &board) {
+    return getThreatenedWhite(board, board.occupied);
+}
 
-inline field getThreatenedBlack(const t_board board) {
-    uint64_t occ = board.occupied;
+
+inline uint64_t getThreatenedBlack(const t_board &board, const uint64_t occ) {
     uint64_t threatened = 0;
 
     // Add uint64_ts covered by the king
     threatened |= lookup<piece::king>(findFirst(board.whiteKing));
 
-    // Add uint64_ts covered by the queens
-    uint64_t queens = board.whiteQueen;
-    while (queens != 0) {
-        threatened |= lookupSlider<piece::queen>(findFirst(queens), occ);
-
-        queens &= (queens - 1);
-    }
-
-    // Add uint64_ts covered by the rooks
-    uint64_t rooks = board.whiteRook;
-    while (rooks != 0) {
-        threatened |= lookupSlider<piece::rook>(findFirst(rooks), occ);
-
-        rooks &= (rooks - 1);
-    }
-
-    // Add uint64_ts covered by the bishops
-    uint64_t bishops = board.whiteBishop;
-    while (bishops != 0) {
-        threatened |= lookupSlider<piece::bishop>(findFirst(bishops), occ);
-        bishops &= (bishops - 1);
-    }
+    // Add uint64_ts covered by the queens, rooks and bishops
+    threatened |= sliderAttacks(board.whiteQueen | board.whiteRook, board.whiteQueen | board.whiteBishop, occ);
 
     // Add uint64_ts covered by the knights
     uint64_t knights = board.whiteKnight;
     while (knights != 0) {
         threatened |= lookup<piece::knight>(findFirst(knights));
-        knights &= (knights - 1);
+        knights = clearFirst(knights);
     }
 
     // Add uint64_ts covered by pawns
@@ -767,114 +921,185 @@ inline field getThreatenedBlack(const t_board board) {
     return threatened;
 }
 
+inline uint64_t getThreatenedBlack(const t_board &board) {
+    return getThreatenedBlack(board, board.occupied);
+}
 
-template<bool color>
-std::vector<t_gameState> generate_moves(t_gameState gameState) {
-    /// THIS APPROACH WAS INSPIRED BY https://github.com/Gigantua/Gigantua ///
 
-    std::vector<t_gameState> moves = std::vector<t_gameState>();
+/*
+ * Position info
+ * Attack information of a position from the view of the moving color: Threatened squares, checks and pins. It is
+ * computed once per node and then shared by move generation, legality checks and end detection, which all used to
+ * generate the attacks on their own.
+ */
+
+typedef struct positionInfo {
+    uint64_t threatened;    // Squares attacked by the opponent, sliders see through the moving king
+    uint64_t checkers;      // Opponent pieces giving check
+    uint64_t checkMask;     // Squares capturing or blocking the check, all squares if there is none
+    uint64_t lateralPins;   // Squares from the king (excluded) to rooks and queens pinning a piece (included)
+    uint64_t diagonalPins;  // Squares from the king (excluded) to bishops and queens pinning a piece (included)
+} t_positionInfo;
+
+
+template<bool color>
+inline t_positionInfo getPositionInfo(const t_board &board) {
+    t_positionInfo info;
 
-    t_board board = gameState.board;
     uint64_t occ = board.occupied;
+    uint64_t king = color ? board.blackKing : board.whiteKing;
+    uint8_t kingShift = findFirst(king);
 
-    uint8_t whiteKingShift = findFirst(board.whiteKing);
-    uint8_t blackKingShift = findFirst(board.blackKing);
-    uint64_t whiteKingMap = board.whiteKing;
-    uint64_t blackKingMap = board.blackKing;
+    uint64_t enemyQueens = color ? board.whiteQueen : board.blackQueen;
+    uint64_t enemyLateralSliders = enemyQueens | (color ? board.whiteRook : board.blackRook);
+    uint64_t enemyDiagonalSliders = enemyQueens | (color ? board.whiteBishop : board.blackBishop);
 
-    if (color) {
-        // Black's turn
 
-        // --------------------------- //
-        // Generate threatened squares //
-        // --------------------------- //
+    // --------------------------- //
+    // Generate threatened squares //
+    // --------------------------- //
 
-        uint64_t threatened = getThreatenedBlack(board);
+    // Sliders see through the king, otherwise stepping back along a checking line would look safe
+    info.threatened = color ? getThreatenedBlack(board, occ ^ king) : getThreatenedWhite(board, occ ^ king);
 
 
-        // ----------------------------------------------------------- //
-        // Generate squares causing checks their corresponding sliders //
-        // ----------------------------------------------------------- //
+    // ----------------------------------------------------------- //
+    // Generate squares causing checks their corresponding sliders //
+    // ----------------------------------------------------------- //
 
-        uint64_t checks = 0;
-        uint64_t checkSliderPieces = 0;
-        {
-            uint64_t kingRookLookup = lookupSlider<piece::rook>(blackKingShift, occ);
-            uint64_t kingBishopLookup = lookupSlider<piece::bishop>(blackKingShift, occ);
-            uint64_t kingKnightLookup = lookup<piece::knight>(blackKingShift);
-
-            if ((threatened & blackKingMap) != 0) {
-                // There is at least one check
-
-                // Check from sliding pieces
-                checkSliderPieces |= kingRookLookup & board.whiteQueen;
-                checkSliderPieces |= kingRookLookup & board.whiteRook;
-                checkSliderPieces |= kingBishopLookup & board.whiteQueen;
-                checkSliderPieces |= kingBishopLookup & board.whiteBishop;
-
-                short checkSliderShift;
-                uint64_t checkSliders = checkSliderPieces;  // Preserve value of checkSliderPieces
-                while (checkSliders != 0) {
-                    checkSliderShift = findFirst(checkSliders);
-                    checks |= xray[64 * blackKingShift + checkSliderShift];
-
-                    checkSliders &= (checkSliders - 1);
-                }
+    info.checkers = 0;
+    info.checkMask = ~(uint64_t) 0;
+    if ((info.threatened & king) != 0) {
+        // There is at least one check
 
-                // Check from knights
-                checks |= kingKnightLookup & board.whiteKnight;
+        // Check from sliding pieces
+        uint64_t checkSliders = (lookupSlider<piece::rook>(kingShift, occ) & enemyLateralSliders) |
+                                (lookupSlider<piece::bishop>(kingShift, occ) & enemyDiagonalSliders);
+        info.checkers |= checkSliders;
 
-                // Check from pawns
-                checks |= ((board.blackKing & ~aFile) << 7) & board.whitePawn;  // Pawns threatening to the right
-                checks |= ((board.blackKing & ~hFile) << 9) & board.whitePawn;  // Pawns threatening to the left
-            }
+        // Check from knights
+        info.checkers |= lookup<piece::knight>(kingShift) & (color ? board.whiteKnight : board.blackKnight);
 
-            // Handle different amounts of checking pieces
-            uint64_t checkOrigins = checks & board.white;
-            if (checkOrigins == 0) {
-                // No checks -> Set all uint64_ts to 1
-                checks = ~0;
-            } else if ((checkOrigins & (checkOrigins - 1)) != 0) {
-                // More than one check -> Only King can move
-                uint64_t kingTargets = lookup<piece::king>(blackKingShift) & ~threatened & ~board.black;
-                moveKing<true>(&moves, gameState, blackKingMap, kingTargets);
-
-                return moves;
-            }
+        // Check from pawns
+        if (color) {
+            info.checkers |= (((king & ~aFile) << 7) | ((king & ~hFile) << 9)) & board.whitePawn;
+        } else {
+            info.checkers |= (((king & ~hFile) >> 7) | ((king & ~aFile) >> 9)) & board.blackPawn;
         }
 
+        // Checks can be answered by taking the checking piece or by blocking its way to the king
+        info.checkMask = info.checkers;
+        while (checkSliders != 0) {
+            info.checkMask |= xray[64 * kingShift + findFirst(checkSliders)];
+            checkSliders = clearFirst(checkSliders);
+        }
+    }
 
-        // --------------------------------------------------------- //
-        // Generate squares causing pins their corresponding sliders //
-        // --------------------------------------------------------- //
 
-        uint64_t pinned;
-        uint64_t lateralPins = 0;
-        uint64_t diagonalPins = 0;
-        {
-            uint64_t kingVerticalMask = verticalMask[blackKingShift];
-            uint64_t kingHorizontalMask = horizontalMask[blackKingShift];
-            uint64_t kingLeftDiagonalMask = lDiagonalMask[blackKingShift];
-            uint64_t kingRightDiagonalMask = rDiagonalMask[blackKingShift];
-
-            uint64_t kingQueenPinLookup = lookupPinSlider<piece::queen>(blackKingShift, occ);
-            uint64_t pinPieces =
-                    kingQueenPinLookup & (board.whiteQueen | board.whiteRook | board.whiteBishop) & ~checkSliderPieces;
-
-            uint64_t lateralPinShift;
-            while (pinPieces != 0) {
-                lateralPinShift = findFirst(pinPieces);
-                uint64_t pinXray = xray[64 * blackKingShift + lateralPinShift];
-
-                lateralPins |= pinXray & kingVerticalMask;
-                lateralPins |= pinXray & kingHorizontalMask;
-                diagonalPins |= pinXray & kingLeftDiagonalMask;
-                diagonalPins |= pinXray & kingRightDiagonalMask;
-
-                pinPieces &= (pinPieces - 1);
+    // --------------------------------------------------------- //
+    // Generate squares causing pins their corresponding sliders //
+    // --------------------------------------------------------- //
+
+    info.lateralPins = 0;
+    info.diagonalPins = 0;
+    {
+        // Sliders only pin along their own lines, a bishop behind a piece on the same file pins nothing
+        uint64_t pinPieces = ((lookupPinSlider<piece::rook>(kingShift, occ) & enemyLateralSliders) |
+                              (lookupPinSlider<piece::bishop>(kingShift, occ) & enemyDiagonalSliders)) & ~info.checkers;
+
+        while (pinPieces != 0) {
+            uint64_t pinXray = xray[64 * kingShift + findFirst(pinPieces)];
+
+            info.lateralPins |= pinXray & (verticalMask[kingShift] | horizontalMask[kingShift]);
+            info.diagonalPins |= pinXray & (lDiagonalMask[kingShift] | rDiagonalMask[kingShift]);
+
+            pinPieces = clearFirst(pinPieces);
+        }
+    }
+
+    return info;
+}
+
+
+/*
+ * Generator variants
+ * All: Every legal move
+ * Captures: Captures, en passant and promotions
+ * Quiets: Every other move, All is exactly Captures plus Quiets
+ * Evasions: Every legal move if the moving color is in check, nothing otherwise
+ * HillThreats: King moves onto or next to the hill
+ */
+
+enum class GenType {
+    All,
+    Captures,
+    Quiets,
+    Evasions,
+    HillThreats
+};
+
+// Squares on the hill or next to it
+inline const uint64_t hillNeighbourhood = kingOfTheHill | ((kingOfTheHill & ~hFile) << 1) | ((kingOfTheHill & ~aFile) >> 1);
+inline const uint64_t hillThreatSquares = hillNeighbourhood | (hillNeighbourhood << 8) | (hillNeighbourhood >> 8);
+
+// Castling needs the squares between king and rook empty, and the squares the king crosses (origin included) safe
+inline const uint64_t blackShortCastleEmptyMask = ((uint64_t) 1 << 5) | ((uint64_t) 1 << 6);
+inline const uint64_t blackShortCastleSafeMask = ((uint64_t) 1 << 4) | blackShortCastleEmptyMask;
+inline const uint64_t blackLongCastleEmptyMask = ((uint64_t) 1 << 1) | ((uint64_t) 1 << 2) | ((uint64_t) 1 << 3);
+inline const uint64_t blackLongCastleSafeMask = ((uint64_t) 1 << 2) | ((uint64_t) 1 << 3) | ((uint64_t) 1 << 4);
+inline const uint64_t whiteShortCastleEmptyMask = blackShortCastleEmptyMask << 56;
+inline const uint64_t whiteShortCastleSafeMask = blackShortCastleSafeMask << 56;
+inline const uint64_t whiteLongCastleEmptyMask = blackLongCastleEmptyMask << 56;
+inline const uint64_t whiteLongCastleSafeMask = blackLongCastleSafeMask << 56;
+
+
+template<bool color, GenType type = GenType::All, typename Visitor>
+void generate_moves(const t_gameState &gameState, const t_positionInfo &info, Visitor &visitor) {
+    /// THIS APPROACH WAS INSPIRED BY https://github.com/Gigantua/Gigantua ///
+    // Hands the legal moves of the given GenType for the moving color to the given visitor, see t_moveListVisitor
+    // info has to be getPositionInfo<color> of the same position
+
+    const t_board &board = gameState.board;
+    uint64_t occ = board.occupied;
+
+    // Squares pieces may move to, capture and quiet variants only differ in these
+    constexpr bool genQuiets = type != GenType::Captures;
+    constexpr bool genCaptures = type != GenType::Quiets;
+    uint64_t targetMask = (genQuiets ? ~occ : 0) | (genCaptures ? (color ? board.white : board.black) : 0);
+
+    uint8_t whiteKingShift = findFirst(board.whiteKing);
+    uint8_t blackKingShift = findFirst(board.blackKing);
+
+    if (color) {
+        // Black's turn
+
+        // Attack information is taken from the position info, see getPositionInfo
+        uint64_t threatened = info.threatened;
+        uint64_t checks = info.checkMask;
+        uint64_t lateralPins = info.lateralPins;
+        uint64_t diagonalPins = info.diagonalPins;
+        uint64_t pinned = lateralPins | diagonalPins;
+
+
+        if constexpr (type == GenType::HillThreats) {
+            // Only king moves onto or next to the hill, these neither depend on checks nor on pins
+            uint64_t kingTargets = lookup<piece::king>(blackKingShift) & ~threatened & targetMask & hillThreatSquares;
+            visitor.piece(blackKingShift, kingTargets, board.white);
+
+            return;
+        }
+
+        // Handle different amounts of checking pieces
+        if (info.checkers == 0) {
+            if constexpr (type == GenType::Evasions) {
+                return;  // Nothing to evade
             }
+        } else if (clearFirst(info.checkers) != 0) {
+            // More than one check -> Only King can move
+            uint64_t kingTargets = lookup<piece::king>(blackKingShift) & ~threatened & targetMask;
+            visitor.piece(blackKingShift, kingTargets, board.white);
 
-            pinned = lateralPins | diagonalPins;
+            return;
         }
 
 
@@ -884,21 +1109,21 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
 
         // Generate king moves
         {
-            uint64_t kingTargets = lookup<piece::king>(blackKingShift) & ~threatened & ~board.black;
-            moveKing<true>(&moves, gameState, blackKingMap, kingTargets);
+            uint64_t kingTargets = lookup<piece::king>(blackKingShift) & ~threatened & targetMask;
+            visitor.piece(blackKingShift, kingTargets, board.white);
         }
 
 
         // Generate castles
-        {
+        if constexpr (genQuiets) {
             if (gameState.bCastleShort && (board.blackRook & hFile & rank8)) {
-                if ((blackShortCastleCheckMask & ((occ ^ board.blackKing) | threatened | ~checks)) == 0) {
-                    moveKingCastleShort<true>(&moves, gameState);
+                if ((blackShortCastleEmptyMask & occ) == 0 && (blackShortCastleSafeMask & threatened) == 0) {
+                    visitor.castleShort(blackKingShift);
                 }
             }
             if (gameState.bCastleLong && (board.blackRook & aFile & rank8)) {
-                if ((blackLongCastleCheckMask & ((occ ^ board.blackKing) | threatened | ~checks)) == 0) {
-                    moveKingCastleLong<true>(&moves, gameState);
+                if ((blackLongCastleEmptyMask & occ) == 0 && (blackLongCastleSafeMask & threatened) == 0) {
+                    visitor.castleLong(blackKingShift);
                 }
             }
         }
@@ -915,26 +1140,26 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (queenOrigins != 0) {
                 queenShift = findFirst(queenOrigins);
 
-                queenTargets = lookupSlider<piece::queen>(queenShift, occ) & checks & ~board.black;
-                moveQueens<true>(&moves, gameState, queenShift, queenTargets);
+                queenTargets = lookupSlider<piece::queen>(queenShift, occ) & checks & targetMask;
+                visitor.piece(queenShift, queenTargets, board.white);
 
-                queenOrigins &= (queenOrigins - 1);
+                queenOrigins = clearFirst(queenOrigins);
             }
             while (queenOriginsPinnedLateral != 0) {
                 queenShift = findFirst(queenOriginsPinnedLateral);
 
-                queenTargets = lookupSlider<piece::rook>(queenShift, occ) & checks & lateralPins & ~board.black;
-                moveQueens<true>(&moves, gameState, queenShift, queenTargets);
+                queenTargets = lookupSlider<piece::rook>(queenShift, occ) & checks & lateralPins & targetMask;
+                visitor.piece(queenShift, queenTargets, board.white);
 
-                queenOriginsPinnedLateral &= (queenOriginsPinnedLateral - 1);
+                queenOriginsPinnedLateral = clearFirst(queenOriginsPinnedLateral);
             }
             while (queenOriginsPinnedDiagonal != 0) {
                 queenShift = findFirst(queenOriginsPinnedDiagonal);
 
-                queenTargets = lookupSlider<piece::bishop>(queenShift, occ) & checks & diagonalPins & ~board.black;
-                moveQueens<true>(&moves, gameState, queenShift, queenTargets);
+                queenTargets = lookupSlider<piece::bishop>(queenShift, occ) & checks & diagonalPins & targetMask;
+                visitor.piece(queenShift, queenTargets, board.white);
 
-                queenOriginsPinnedDiagonal &= (queenOriginsPinnedDiagonal - 1);
+                queenOriginsPinnedDiagonal = clearFirst(queenOriginsPinnedDiagonal);
             }
         }
 
@@ -949,18 +1174,18 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (rookOrigins != 0) {
                 rookShift = findFirst(rookOrigins);
 
-                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & ~board.black;
-                moveRooks<true>(&moves, gameState, rookShift, rookTargets);
+                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & targetMask;
+                visitor.piece(rookShift, rookTargets, board.white);
 
-                rookOrigins &= (rookOrigins - 1);
+                rookOrigins = clearFirst(rookOrigins);
             }
             while (rookOriginsPinned != 0) {
                 rookShift = findFirst(rookOriginsPinned);
 
-                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & lateralPins & ~board.black;
-                moveRooks<true>(&moves, gameState, rookShift, rookTargets);
+                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & lateralPins & targetMask;
+                visitor.piece(rookShift, rookTargets, board.white);
 
-                rookOriginsPinned &= (rookOriginsPinned - 1);
+                rookOriginsPinned = clearFirst(rookOriginsPinned);
             }
         }
 
@@ -976,18 +1201,18 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (bishopOrigins != 0) {
                 bishopShift = findFirst(bishopOrigins);
 
-                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & ~board.black;
-                moveBishops<true>(&moves, gameState, bishopShift, bishopTargets);
+                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & targetMask;
+                visitor.piece(bishopShift, bishopTargets, board.white);
 
-                bishopOrigins &= (bishopOrigins - 1);
+                bishopOrigins = clearFirst(bishopOrigins);
             }
             while (bishopOriginsPinned != 0) {
                 bishopShift = findFirst(bishopOriginsPinned);
 
-                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & diagonalPins & ~board.black;
-                moveBishops<true>(&moves, gameState, bishopShift, bishopTargets);
+                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & diagonalPins & targetMask;
+                visitor.piece(bishopShift, bishopTargets, board.white);
 
-                bishopOriginsPinned &= (bishopOriginsPinned - 1);
+                bishopOriginsPinned = clearFirst(bishopOriginsPinned);
             }
         }
 
@@ -1001,17 +1226,19 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (knightOrigins != 0) {
                 knightShift = findFirst(knightOrigins);
 
-                knightTargets = lookup<piece::knight>(knightShift) & checks & ~board.black;
-                moveKnights<true>(&moves, gameState, knightShift, knightTargets);
+                knightTargets = lookup<piece::knight>(knightShift) & checks & targetMask;
+                visitor.piece(knightShift, knightTargets, board.white);
 
-                knightOrigins &= (knightOrigins - 1);
+                knightOrigins = clearFirst(knightOrigins);
             }
         }
 
 
         // Generate pawn moves
         {
-            uint64_t pawnTargets = ((board.blackPawn & ~diagonalPins) << 8) & checks & ~occ;
+            // Pinned pawns may only push along a file pin
+            uint64_t pawnTargets = ((board.blackPawn & ~pinned) << 8) & checks & ~occ;
+            pawnTargets |= ((board.blackPawn & lateralPins) << 8) & checks & lateralPins & ~occ;
 
             uint64_t pawnTargetsPromotion = pawnTargets & rank1;
             pawnTargets &= ~pawnTargetsPromotion;
@@ -1019,23 +1246,30 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             uint64_t pawnOrigins = pawnTargets >> 8;
             uint64_t pawnOriginsPromotion = pawnTargetsPromotion >> 8;
 
-            movePawns<true>(&moves, gameState, pawnOrigins, pawnTargets);
-            movePawnsPromotion<true>(&moves, gameState, pawnOriginsPromotion, pawnTargetsPromotion);
+            if constexpr (genQuiets) {
+                visitor.pawns(pawnOrigins, pawnTargets, board.white);
+            }
+            if constexpr (genCaptures) {
+                // Promotions count as captures, as both change the material balance
+                visitor.pawnsPromotion(pawnOriginsPromotion, pawnTargetsPromotion, board.white);
+            }
         }
 
 
         // Generate pawn pushing moves
-        {
+        if constexpr (genQuiets) {
             uint64_t pawnPushTargets =
-                    ((((board.blackPawn & rank7 & ~diagonalPins) << 8) & ~occ) << 8) & checks & ~occ;
+                    ((((board.blackPawn & rank7 & ~pinned) << 8) & ~occ) << 8) & checks & ~occ;
+            pawnPushTargets |=
+                    ((((board.blackPawn & rank7 & lateralPins) << 8) & ~occ) << 8) & checks & lateralPins & ~occ;
             uint64_t pawnPushOrigins = pawnPushTargets >> 16;
 
-            movePawnsPush<true>(&moves, gameState, pawnPushOrigins, pawnPushTargets);
+            visitor.pawnsPush(pawnPushOrigins, pawnPushTargets);
         }
 
 
         // Generate pawn taking moves
-        {
+        if constexpr (genCaptures) {
             uint64_t pawnTakeRightTargets;
             pawnTakeRightTargets = ((board.blackPawn & ~aFile & ~pinned) << 7) & checks & board.white;
             pawnTakeRightTargets |=
@@ -1047,8 +1281,8 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             uint64_t pawnTakeRightOrigins = pawnTakeRightTargets >> 7;
             uint64_t pawnTakeRightOriginsPromotion = pawnTakeRightTargetsPromotion >> 7;
 
-            movePawns<true>(&moves, gameState, pawnTakeRightOrigins, pawnTakeRightTargets);
-            movePawnsPromotion<true>(&moves, gameState, pawnTakeRightOriginsPromotion, pawnTakeRightTargetsPromotion);
+            visitor.pawns(pawnTakeRightOrigins, pawnTakeRightTargets, board.white);
+            visitor.pawnsPromotion(pawnTakeRightOriginsPromotion, pawnTakeRightTargetsPromotion, board.white);
 
 
             uint64_t pawnTakeLeftTargets;
@@ -1062,132 +1296,70 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             uint64_t pawnTakeLeftOrigins = pawnTakeLeftTargets >> 9;
             uint64_t pawnTakeLeftOriginsPromotion = pawnTakeLeftTargetsPromotion >> 9;
 
-            movePawns<true>(&moves, gameState, pawnTakeLeftOrigins, pawnTakeLeftTargets);
-            movePawnsPromotion<true>(&moves, gameState, pawnTakeLeftOriginsPromotion, pawnTakeLeftTargetsPromotion);
+            visitor.pawns(pawnTakeLeftOrigins, pawnTakeLeftTargets, board.white);
+            visitor.pawnsPromotion(pawnTakeLeftOriginsPromotion, pawnTakeLeftTargetsPromotion, board.white);
         }
 
 
         // Generate en-passants
-        {
-            // TODO: Approaches (left & right) not working for enpassant=8
-            uint64_t pawnEnPassantRightTarget;  // There can only be one en-passant move per direction
-            pawnEnPassantRightTarget =
-                    ((board.blackPawn & ~aFile & (aFile << (gameState.enpassant)) & rank4 & ~pinned) << 7) & checks;
-            pawnEnPassantRightTarget |=
-                    ((board.blackPawn & ~aFile & (aFile << (gameState.enpassant)) & rank4 & diagonalPins) << 7) &
-                    checks &
-                    diagonalPins;
-            uint64_t pawnEnPassantRightOrigins = pawnEnPassantRightTarget >> 7;
-
-            movePawnsEnPassant<true>(&moves, gameState, pawnEnPassantRightOrigins, pawnEnPassantRightTarget);
-
-
-            uint64_t pawnEnPassantLeftTarget;  // There can only be one en-passant move per direction
-            pawnEnPassantLeftTarget =
-                    ((board.blackPawn & ~hFile & (hFile >> (8 - gameState.enpassant)) & rank4 & ~pinned) << 9) & checks;
-            pawnEnPassantLeftTarget |=
-                    ((board.blackPawn & ~hFile & (hFile >> (8 - gameState.enpassant)) & rank4 & diagonalPins) << 9) & checks & diagonalPins;
-            uint64_t pawnEnPassantLeftOrigins = pawnEnPassantLeftTarget >> 9;
-
-            movePawnsEnPassant<true>(&moves, gameState, pawnEnPassantLeftOrigins, pawnEnPassantLeftTarget);
+        if constexpr (genCaptures) {
+            if (gameState.enpassant != 0) {
+                uint64_t pawnEnPassantTarget = (aFile << (gameState.enpassant - 1)) & rank3;
+                uint64_t pawnEnPassantTaken = (pawnEnPassantTarget >> 8) & board.whitePawn;
+
+                // Either blocks a check or takes the checking pawn
+                if (((pawnEnPassantTarget | pawnEnPassantTaken) & checks) != 0) {
+                    uint64_t pawnEnPassantOrigins =
+                            (((pawnEnPassantTaken & ~aFile) >> 1) | ((pawnEnPassantTaken & ~hFile) << 1)) & board.blackPawn;
+
+                    // Two pawns leave their squares at once, so pins are checked on the board after the move
+                    uint64_t pawnEnPassantOrigin;
+                    while (pawnEnPassantOrigins != 0) {
+                        pawnEnPassantOrigin = isolateFirst(pawnEnPassantOrigins);
+
+                        uint64_t occAfter = (occ ^ pawnEnPassantOrigin ^ pawnEnPassantTaken) | pawnEnPassantTarget;
+                        uint64_t kingAttackers =
+                                (lookupSlider<piece::rook>(blackKingShift, occAfter) & (board.whiteRook | board.whiteQueen)) |
+                                (lookupSlider<piece::bishop>(blackKingShift, occAfter) & (board.whiteBishop | board.whiteQueen));
+                        if (kingAttackers == 0) {
+                            visitor.pawnsEnPassant(pawnEnPassantOrigin, pawnEnPassantTarget);
+                        }
+
+                        pawnEnPassantOrigins = clearFirst(pawnEnPassantOrigins);
+                    }
+                }
+            }
         }
-
-
-        // TODO: Fix en-passant pin thingy
-        int test = 0;
     } else {
         // White's turn
 
-        // --------------------------- //
-        // Generate threatened squares //
-        // --------------------------- //
-
-        uint64_t threatened = getThreatenedWhite(board);
-
-
-        // ----------------------------------------------------------- //
-        // Generate squares causing checks their corresponding sliders //
-        // ----------------------------------------------------------- //
-
-        uint64_t checks = 0;
-        uint64_t checkSliderPieces = 0;
-        {
-            uint64_t kingRookLookup = lookupSlider<piece::rook>(whiteKingShift, occ);
-            uint64_t kingBishopLookup = lookupSlider<piece::bishop>(whiteKingShift, occ);
-            uint64_t kingKnightLookup = lookup<piece::knight>(whiteKingShift);
-
-            if ((threatened & whiteKingMap) != 0) {
-                // There is at least one check
-
-                // Check from sliding pieces
-                checkSliderPieces |= kingRookLookup & board.blackQueen;
-                checkSliderPieces |= kingRookLookup & board.blackRook;
-                checkSliderPieces |= kingBishopLookup & board.blackQueen;
-                checkSliderPieces |= kingBishopLookup & board.blackBishop;
-
-                short checkSliderShift;
-                uint64_t checkSliders = checkSliderPieces;  // Preserve value of checkSliderPieces
-                while (checkSliders != 0) {
-                    checkSliderShift = findFirst(checkSliders);
-                    checks |= xray[64 * whiteKingShift + checkSliderShift];
-
-                    checkSliders &= (checkSliders - 1);
-                }
+        // Attack information is taken from the position info, see getPositionInfo
+        uint64_t threatened = info.threatened;
+        uint64_t checks = info.checkMask;
+        uint64_t lateralPins = info.lateralPins;
+        uint64_t diagonalPins = info.diagonalPins;
+        uint64_t pinned = lateralPins | diagonalPins;
 
-                // Check from knights
-                checks |= kingKnightLookup & board.blackKnight;
 
-                // Check from pawns
-                checks |= ((board.whiteKing & ~aFile) >> 7) & board.blackPawn;  // Pawns threatening to the left
-                checks |= ((board.whiteKing & ~hFile) >> 9) & board.blackPawn;  // Pawns threatening to the right
-            }
+        if constexpr (type == GenType::HillThreats) {
+            // Only king moves onto or next to the hill, these neither depend on checks nor on pins
+            uint64_t kingTargets = lookup<piece::king>(whiteKingShift) & ~threatened & targetMask & hillThreatSquares;
+            visitor.piece(whiteKingShift, kingTargets, board.black);
 
-            // Handle different amounts of checking pieces
-            uint64_t checkPieces = checks & board.black;
-            if (checkPieces == 0) {
-                // No checks -> Set all uint64_ts to 1
-                checks = ~0;
-            } else if ((checkPieces & (checkPieces - 1)) != 0) {
-                // More than one check -> Only King can move
-                uint64_t kingTargets = lookup<piece::king>(whiteKingShift) & ~threatened & ~board.white;
-                moveKing<false>(&moves, gameState, whiteKingMap, kingTargets);
-
-                return moves;
-            }
+            return;
         }
 
-
-        // --------------------------------------------------------- //
-        // Generate squares causing pins their corresponding sliders //
-        // --------------------------------------------------------- //
-
-        uint64_t pinned;
-        uint64_t lateralPins = 0;
-        uint64_t diagonalPins = 0;
-        {
-            uint64_t kingVerticalMask = verticalMask[whiteKingShift];
-            uint64_t kingHorizontalMask = horizontalMask[whiteKingShift];
-            uint64_t kingLeftDiagonalMask = lDiagonalMask[whiteKingShift];
-            uint64_t kingRightDiagonalMask = rDiagonalMask[whiteKingShift];
-
-            uint64_t kingQueenPinLookup = lookupPinSlider<piece::queen>(whiteKingShift, occ);
-            uint64_t pinPieces =
-                    kingQueenPinLookup & (board.blackQueen | board.blackRook | board.blackBishop) & ~checkSliderPieces;
-
-            uint64_t lateralPinShift;
-            while (pinPieces != 0) {
-                lateralPinShift = findFirst(pinPieces);
-                uint64_t pinXray = xray[64 * whiteKingShift + lateralPinShift];
-
-                lateralPins |= pinXray & kingVerticalMask;
-                lateralPins |= pinXray & kingHorizontalMask;
-                diagonalPins |= pinXray & kingLeftDiagonalMask;
-                diagonalPins |= pinXray & kingRightDiagonalMask;
-
-                pinPieces &= (pinPieces - 1);
+        // Handle different amounts of checking pieces
+        if (info.checkers == 0) {
+            if constexpr (type == GenType::Evasions) {
+                return;  // Nothing to evade
             }
+        } else if (clearFirst(info.checkers) != 0) {
+            // More than one check -> Only King can move
+            uint64_t kingTargets = lookup<piece::king>(whiteKingShift) & ~threatened & targetMask;
+            visitor.piece(whiteKingShift, kingTargets, board.black);
 
-            pinned = lateralPins | diagonalPins;
+            return;
         }
 
 
@@ -1197,21 +1369,21 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
 
         // Generate king moves
         {
-            uint64_t kingTargets = lookup<piece::king>(whiteKingShift) & ~threatened & ~board.white;
-            moveKing<false>(&moves, gameState, whiteKingMap, kingTargets);
+            uint64_t kingTargets = lookup<piece::king>(whiteKingShift) & ~threatened & targetMask;
+            visitor.piece(whiteKingShift, kingTargets, board.black);
         }
 
 
         // Generate castles
-        {
+        if constexpr (genQuiets) {
             if (gameState.wCastleShort && (board.whiteRook & hFile & rank1)) {
-                if ((whiteShortCastleCheckMask & ((occ ^ board.whiteKing) | threatened | ~checks)) == 0) {
-                    moveKingCastleShort<false>(&moves, gameState);
+                if ((whiteShortCastleEmptyMask & occ) == 0 && (whiteShortCastleSafeMask & threatened) == 0) {
+                    visitor.castleShort(whiteKingShift);
                 }
             }
             if (gameState.wCastleLong && (board.whiteRook & aFile & rank1)) {
-                if ((whiteLongCastleCheckMask & ((occ ^ board.whiteKing) | threatened | ~checks)) == 0) {
-                    moveKingCastleLong<false>(&moves, gameState);
+                if ((whiteLongCastleEmptyMask & occ) == 0 && (whiteLongCastleSafeMask & threatened) == 0) {
+                    visitor.castleLong(whiteKingShift);
                 }
             }
         }
@@ -1228,26 +1400,26 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (queenOrigins != 0) {
                 queenShift = findFirst(queenOrigins);
 
-                queenTargets = lookupSlider<piece::queen>(queenShift, occ) & checks & ~board.white;
-                moveQueens<false>(&moves, gameState, queenShift, queenTargets);
+                queenTargets = lookupSlider<piece::queen>(queenShift, occ) & checks & targetMask;
+                visitor.piece(queenShift, queenTargets, board.black);
 
-                queenOrigins &= (queenOrigins - 1);
+                queenOrigins = clearFirst(queenOrigins);
             }
             while (queenOriginsPinnedLateral != 0) {
                 queenShift = findFirst(queenOriginsPinnedLateral);
 
-                queenTargets = lookupSlider<piece::rook>(queenShift, occ) & checks & lateralPins & ~board.white;
-                moveQueens<false>(&moves, gameState, queenShift, queenTargets);
+                queenTargets = lookupSlider<piece::rook>(queenShift, occ) & checks & lateralPins & targetMask;
+                visitor.piece(queenShift, queenTargets, board.black);
 
-                queenOriginsPinnedLateral &= (queenOriginsPinnedLateral - 1);
+                queenOriginsPinnedLateral = clearFirst(queenOriginsPinnedLateral);
             }
             while (queenOriginsPinnedDiagonal != 0) {
                 queenShift = findFirst(queenOriginsPinnedDiagonal);
 
-                queenTargets = lookupSlider<piece::bishop>(queenShift, occ) & checks & diagonalPins & ~board.white;
-                moveQueens<false>(&moves, gameState, queenShift, queenTargets);
+                queenTargets = lookupSlider<piece::bishop>(queenShift, occ) & checks & diagonalPins & targetMask;
+                visitor.piece(queenShift, queenTargets, board.black);
 
-                queenOriginsPinnedDiagonal &= (queenOriginsPinnedDiagonal - 1);
+                queenOriginsPinnedDiagonal = clearFirst(queenOriginsPinnedDiagonal);
             }
         }
 
@@ -1262,18 +1434,18 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (rookOrigins != 0) {
                 rookShift = findFirst(rookOrigins);
 
-                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & ~board.white;
-                moveRooks<false>(&moves, gameState, rookShift, rookTargets);
+                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & targetMask;
+                visitor.piece(rookShift, rookTargets, board.black);
 
-                rookOrigins &= (rookOrigins - 1);
+                rookOrigins = clearFirst(rookOrigins);
             }
             while (rookOriginsPinned != 0) {
                 rookShift = findFirst(rookOriginsPinned);
 
-                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & lateralPins & ~board.white;
-                moveRooks<false>(&moves, gameState, rookShift, rookTargets);
+                rookTargets = lookupSlider<piece::rook>(rookShift, occ) & checks & lateralPins & targetMask;
+                visitor.piece(rookShift, rookTargets, board.black);
 
-                rookOriginsPinned &= (rookOriginsPinned - 1);
+                rookOriginsPinned = clearFirst(rookOriginsPinned);
             }
         }
 
@@ -1289,18 +1461,18 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (bishopOrigins != 0) {
                 bishopShift = findFirst(bishopOrigins);
 
-                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & ~board.white;
-                moveBishops<false>(&moves, gameState, bishopShift, bishopTargets);
+                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & targetMask;
+                visitor.piece(bishopShift, bishopTargets, board.black);
 
-                bishopOrigins &= (bishopOrigins - 1);
+                bishopOrigins = clearFirst(bishopOrigins);
             }
             while (bishopOriginsPinned != 0) {
                 bishopShift = findFirst(bishopOriginsPinned);
 
-                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & diagonalPins & ~board.white;
-                moveBishops<false>(&moves, gameState, bishopShift, bishopTargets);
+                bishopTargets = lookupSlider<piece::bishop>(bishopShift, occ) & checks & diagonalPins & targetMask;
+                visitor.piece(bishopShift, bishopTargets, board.black);
 
-                bishopOriginsPinned &= (bishopOriginsPinned - 1);
+                bishopOriginsPinned = clearFirst(bishopOriginsPinned);
             }
         }
 
@@ -1314,17 +1486,19 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             while (knightOrigins != 0) {
                 knightShift = findFirst(knightOrigins);
 
-                knightTargets = lookup<piece::knight>(knightShift) & checks & ~board.white;
-                moveKnights<false>(&moves, gameState, knightShift, knightTargets);
+                knightTargets = lookup<piece::knight>(knightShift) & checks & targetMask;
+                visitor.piece(knightShift, knightTargets, board.black);
 
-                knightOrigins &= (knightOrigins - 1);
+                knightOrigins = clearFirst(knightOrigins);
             }
         }
 
 
         // Generate pawn moves
         {
-            uint64_t pawnTargets = ((board.whitePawn & ~diagonalPins) >> 8) & checks & ~occ;
+            // Pinned pawns may only push along a file pin
+            uint64_t pawnTargets = ((board.whitePawn & ~pinned) >> 8) & checks & ~occ;
+            pawnTargets |= ((board.whitePawn & lateralPins) >> 8) & checks & lateralPins & ~occ;
 
             uint64_t pawnTargetsPromotion = pawnTargets & rank8;
             pawnTargets &= ~pawnTargetsPromotion;
@@ -1332,23 +1506,30 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             uint64_t pawnOrigins = pawnTargets << 8;
             uint64_t pawnOriginsPromotion = pawnTargetsPromotion << 8;
 
-            movePawns<false>(&moves, gameState, pawnOrigins, pawnTargets);
-            movePawnsPromotion<false>(&moves, gameState, pawnOriginsPromotion, pawnTargetsPromotion);
+            if constexpr (genQuiets) {
+                visitor.pawns(pawnOrigins, pawnTargets, board.black);
+            }
+            if constexpr (genCaptures) {
+                // Promotions count as captures, as both change the material balance
+                visitor.pawnsPromotion(pawnOriginsPromotion, pawnTargetsPromotion, board.black);
+            }
         }
 
 
         // Generate pawn pushing moves
-        {
+        if constexpr (genQuiets) {
             uint64_t pawnPushTargets =
-                    ((((board.whitePawn & rank2 & ~diagonalPins) >> 8) & ~occ) >> 8) & checks & ~occ;
+                    ((((board.whitePawn & rank2 & ~pinned) >> 8) & ~occ) >> 8) & checks & ~occ;
+            pawnPushTargets |=
+                    ((((board.whitePawn & rank2 & lateralPins) >> 8) & ~occ) >> 8) & checks & lateralPins & ~occ;
             uint64_t pawnPushOrigins = pawnPushTargets << 16;
 
-            movePawnsPush<false>(&moves, gameState, pawnPushOrigins, pawnPushTargets);
+            visitor.pawnsPush(pawnPushOrigins, pawnPushTargets);
         }
 
 
         // Generate pawn taking moves
-        {
+        if constexpr (genCaptures) {
             uint64_t pawnTakeRightTargets;
             pawnTakeRightTargets = ((board.whitePawn & ~hFile & ~pinned) >> 7) & checks & board.black;
             pawnTakeRightTargets |=
@@ -1360,8 +1541,8 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             uint64_t pawnTakeRightOrigins = pawnTakeRightTargets << 7;
             uint64_t pawnTakeRightOriginsPromotion = pawnTakeRightTargetsPromotion << 7;
 
-            movePawns<false>(&moves, gameState, pawnTakeRightOrigins, pawnTakeRightTargets);
-            movePawnsPromotion<false>(&moves, gameState, pawnTakeRightOriginsPromotion, pawnTakeRightTargetsPromotion);
+            visitor.pawns(pawnTakeRightOrigins, pawnTakeRightTargets, board.black);
+            visitor.pawnsPromotion(pawnTakeRightOriginsPromotion, pawnTakeRightTargetsPromotion, board.black);
 
 
             uint64_t pawnTakeLeftTargets;
@@ -1375,48 +1556,212 @@ std::vector<t_gameState> generate_moves(t_gameState gameState) {
             uint64_t pawnTakeLeftOrigins = pawnTakeLeftTargets << 9;
             uint64_t pawnTakeLeftOriginsPromotion = pawnTakeLeftTargetsPromotion << 9;
 
-            movePawns<false>(&moves, gameState, pawnTakeLeftOrigins, pawnTakeLeftTargets);
-            movePawnsPromotion<false>(&moves, gameState, pawnTakeLeftOriginsPromotion, pawnTakeLeftTargetsPromotion);
+            visitor.pawns(pawnTakeLeftOrigins, pawnTakeLeftTargets, board.black);
+            visitor.pawnsPromotion(pawnTakeLeftOriginsPromotion, pawnTakeLeftTargetsPromotion, board.black);
         }
 
 
         // Generate en-passants
-        {
-            uint64_t pawnEnPassantLeftTarget;  // There can only be one en-passant move per direction
-            pawnEnPassantLeftTarget =
-                    ((board.whitePawn & ~aFile & (aFile << (gameState.enpassant)) & rank5 & ~pinned) >> 9) & checks;
-            pawnEnPassantLeftTarget |=
-                    ((board.whitePawn & ~aFile & (aFile << (gameState.enpassant)) & rank5 & diagonalPins) >> 9) &
-                    checks &
-                    diagonalPins;
-            uint64_t pawnEnPassantLeftOrigins = pawnEnPassantLeftTarget << 9;
-
-            movePawnsEnPassant<false>(&moves, gameState, pawnEnPassantLeftOrigins, pawnEnPassantLeftTarget);
-
-
-            uint64_t pawnEnPassantRightTarget;  // There can only be one en-passant move per direction
-            pawnEnPassantRightTarget =
-                    ((((board.whitePawn & ~hFile & ~pinned) << 1) & (hFile >> (8 - gameState.enpassant)) & rank5) >> 8) & checks;
-            pawnEnPassantRightTarget |=
-                    ((((board.whitePawn & ~hFile & diagonalPins) << 1) & (hFile >> (8 - gameState.enpassant)) & rank5) >> 8) & checks & diagonalPins;
-            uint64_t pawnEnPassantRightOrigins = pawnEnPassantRightTarget << 7;
-
-            movePawnsEnPassant<false>(&moves, gameState, pawnEnPassantRightOrigins, pawnEnPassantRightTarget);
+        if constexpr (genCaptures) {
+            if (gameState.enpassant != 0) {
+                uint64_t pawnEnPassantTarget = (aFile << (gameState.enpassant - 1)) & rank6;
+                uint64_t pawnEnPassantTaken = (pawnEnPassantTarget << 8) & board.blackPawn;
+
+                // Either blocks a check or takes the checking pawn
+                if (((pawnEnPassantTarget | pawnEnPassantTaken) & checks) != 0) {
+                    uint64_t pawnEnPassantOrigins =
+                            (((pawnEnPassantTaken & ~aFile) >> 1) | ((pawnEnPassantTaken & ~hFile) << 1)) & board.whitePawn;
+
+                    // Two pawns leave their squares at once, so pins are checked on the board after the move
+                    uint64_t pawnEnPassantOrigin;
+                    while (pawnEnPassantOrigins != 0) {
+                        pawnEnPassantOrigin = isolateFirst(pawnEnPassantOrigins);
+
+                        uint64_t occAfter = (occ ^ pawnEnPassantOrigin ^ pawnEnPassantTaken) | pawnEnPassantTarget;
+                        uint64_t kingAttackers =
+                                (lookupSlider<piece::rook>(whiteKingShift, occAfter) & (board.blackRook | board.blackQueen)) |
+                                (lookupSlider<piece::bishop>(whiteKingShift, occAfter) & (board.blackBishop | board.blackQueen));
+                        if (kingAttackers == 0) {
+                            visitor.pawnsEnPassant(pawnEnPassantOrigin, pawnEnPassantTarget);
+                        }
+
+                        pawnEnPassantOrigins = clearFirst(pawnEnPassantOrigins);
+                    }
+                }
+            }
         }
+    }
+}
 
 
-        // TODO: Fix en-passant pin thingy
+template<bool color, GenType type = GenType::All, typename Visitor>
+inline void generate_moves(const t_gameState &gameState, Visitor &visitor) {
+    generate_moves<color, type>(gameState, getPositionInfo<color>(gameState.board), visitor);
+}
+
+template<bool color, GenType type = GenType::All>
+inline void generate_moves(const t_gameState &gameState, const t_positionInfo &info, MoveList *moves) {
+    // Appends the legal moves of the given GenType for the moving color to the given move list
+    t_moveListVisitor visitor(moves);
+    generate_moves<color, type>(gameState, info, visitor);
+}
+
+template<bool color, GenType type = GenType::All>
+inline void generate_moves(const t_gameState &gameState, MoveList *moves) {
+    generate_moves<color, type>(gameState, getPositionInfo<color>(gameState.board), moves);
+}
+
+
+template<bool color>
+inline uint64_t perft(t_gameState &state, int depth) {
+    /* Count the leaf nodes of the legal move tree below state, for measuring and verifying the move generator
+     * Arguments:
+     *  state: State with color to move, played on in place and restored before returning
+     *  depth: Remaining plies, the last ply is bulk-counted without playing any of its moves
+     */
+
+    if (depth <= 0) {
+        return 1;
+    }
+
+    if (depth == 1) {
+        t_moveCountVisitor counter;
+        generate_moves<color>(state, counter);
+        return counter.count;
     }
 
-    return moves;
+    MoveList moves;
+    generate_moves<color>(state, &moves);
+
+    uint64_t nodes = 0;
+    t_undo undo;
+    for (const t_move mov: moves) {
+        makeMove<color>(state, mov, &undo);
+        nodes += perft<!color>(state, depth - 1);
+        unmakeMove<color>(state, undo);
+    }
+
+    return nodes;
 }
 
 
-inline void printMove(t_gameState state, char end = '\n') {
-    t_move move = state.move;
+template<bool color>
+inline static bool isMoveLegal(const t_gameState &gameState, const t_positionInfo &info, const t_move mov) {
+    /* Check whether mov is one of the moves generate_moves<color> would produce for gameState
+     * Meant for moves from outside the generator (transposition table, killer moves), which may not fit the
+     * position at all. Regular moves are checked directly, castling, en passant and promotions are rare enough
+     * to be checked against the generated moves instead. info has to be getPositionInfo<color> of gameState.
+     */
+
+    if (mov.isNull()) {
+        return false;
+    }
+
+    uint8_t flags = mov.flags();
+    if (flags == MOVE_FLAG_CASTLE_SHORT || flags == MOVE_FLAG_CASTLE_LONG || flags == MOVE_FLAG_EN_PASSANT ||
+        mov.isPromotion()) {
+        MoveList moves;
+        generate_moves<color>(gameState, info, &moves);
+        for (const t_move generated: moves) {
+            if (generated == mov) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const t_board &board = gameState.board;
+    uint64_t origin = mov.originMap();
+    uint64_t target = mov.targetMap();
+    uint64_t own = color ? board.black : board.white;
+    uint64_t enemy = color ? board.white : board.black;
+
+    if ((target & own) != 0 || mov.isCapture() != ((target & enemy) != 0)) {
+        return false;
+    }
+
+    piece moving = pieceAt<color>(board, mov.origin());
+    if (flags == MOVE_FLAG_DOUBLE_PUSH ? moving != piece::pawn : flags != MOVE_FLAG_QUIET && flags != MOVE_FLAG_CAPTURE) {
+        return false;
+    }
+
+    uint64_t reachable;
+    switch (moving) {
+        case piece::king:
+            reachable = lookup<piece::king>(mov.origin());
+            break;
+        case piece::queen:
+            reachable = lookupSlider<piece::queen>(mov.origin(), board.occupied);
+            break;
+        case piece::rook:
+            reachable = lookupSlider<piece::rook>(mov.origin(), board.occupied);
+            break;
+        case piece::bishop:
+            reachable = lookupSlider<piece::bishop>(mov.origin(), board.occupied);
+            break;
+        case piece::knight:
+            reachable = lookup<piece::knight>(mov.origin());
+            break;
+        case piece::pawn: {
+            if ((target & (rank1 | rank8)) != 0) {
+                return false;  // Reaching the last rank is always a promotion
+            }
+
+            uint64_t push = (color ? origin << 8 : origin >> 8) & ~board.occupied;
+            if (flags == MOVE_FLAG_DOUBLE_PUSH) {
+                reachable = (color ? (push & rank6) << 8 : (push & rank3) >> 8) & ~board.occupied;
+            } else if (mov.isCapture()) {
+                reachable = color ? ((origin & ~aFile) << 7) | ((origin & ~hFile) << 9)
+                                  : ((origin & ~aFile) >> 9) | ((origin & ~hFile) >> 7);
+            } else {
+                reachable = push;
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+
+    if ((reachable & target) == 0) {
+        return false;
+    }
+
+    // Pseudo-legal -> The move must not leave the own king threatened
+    if (moving == piece::king) {
+        return (target & info.threatened) == 0;
+    }
+    if (clearFirst(info.checkers) != 0 || (target & info.checkMask) == 0) {
+        return false;  // Double check, or the move neither takes nor blocks the checking piece
+    }
+    if ((origin & (info.lateralPins | info.diagonalPins)) != 0) {
+        // Pinned pieces may only move along the line between their king and the pinning piece
+        uint8_t kingShift = findFirst(color ? board.blackKing : board.whiteKing);
+        uint64_t pinLine;
+        if ((origin & verticalMask[kingShift]) != 0) {
+            pinLine = verticalMask[kingShift];
+        } else if ((origin & horizontalMask[kingShift]) != 0) {
+            pinLine = horizontalMask[kingShift];
+        } else if ((origin & lDiagonalMask[kingShift]) != 0) {
+            pinLine = lDiagonalMask[kingShift];
+        } else {
+            pinLine = rDiagonalMask[kingShift];
+        }
+
+        return (target & pinLine) != 0;
+    }
+
+    return true;
+}
+
+template<bool color>
+inline static bool isMoveLegal(const t_gameState &gameState, const t_move mov) {
+    return isMoveLegal<color>(gameState, getPositionInfo<color>(gameState.board), mov);
+}
+
 
-    uint8_t originShift = (uint8_t )log2((double )move.originMap);
-    uint8_t targetShift = (uint8_t )log2((double )move.targetMap);
+inline void printMove(t_move move, char end = '\n') {
+    uint8_t originShift = move.origin();
+    uint8_t targetShift = move.target();
 
     Position originPosition = position_from_shift(originShift);
     Position targetPosition = position_from_shift(targetShift);
@@ -0,0 +1,54 @@
+#include "moveMaps.h"
+
+
+/*
+ * Slider lookups
+ * Every square owns the block of entries starting at its lookup offset, one entry per occupancy of its move map. The
+ * PEXT tables are indexed by the occupancy packed in ascending square order (occFromIndex), the magic tables by the
+ * magic multiplication of that occupancy. The pin lookups ignore the first obstruction in every direction, so a pinned
+ * piece does not hide the pinning slider.
+ *
+ * All tables are evaluated at compile time, which takes a while and needs a raised constexpr operation limit (see
+ * CMakeLists.txt). They are kept in this single translation unit, so they are only evaluated once per build.
+ */
+
+
+template<bool rook, int piecesIgnorable, bool magic>
+constexpr auto generateSliderLookup() {
+    const std::array<uint64_t, 64> &moves = rook ? rookMoves : bishopMoves;
+    const std::array<uint32_t, 65> &offsets = rook ? rookLookupOffset : bishopLookupOffset;
+
+    std::array<uint64_t, rook ? rookLookupSize : bishopLookupSize> table{};
+    for (int shift = 0; shift < 64; shift++) {
+        for (uint32_t occIndex = 0; occIndex < offsets[shift + 1] - offsets[shift]; occIndex++) {
+            uint64_t occ = occFromIndex(moves[shift], occIndex);
+
+            uint32_t index = occIndex;
+            if constexpr (magic) {
+                uint64_t magicFactor = rook ? rookMagics[shift] : bishopMagics[shift];
+                uint64_t magicShift = rook ? rookMagicShift[shift] : bishopMagicShift[shift];
+                index = (uint32_t) ((occ * magicFactor) >> magicShift);
+            }
+
+            table[offsets[shift] + index] = rook ? generateRookLookup(shift, occ, piecesIgnorable)
+                                                 : generateBishopLookup(shift, occ, piecesIgnorable);
+        }
+    }
+
+    return table;
+}
+
+
+#ifdef SLIDER_LOOKUP_PEXT
+constexpr std::array<uint64_t, rookLookupSize> rookLookup = generateSliderLookup<true, 0, false>();
+constexpr std::array<uint64_t, rookLookupSize> rookPinLookup = generateSliderLookup<true, 1, false>();
+constexpr std::array<uint64_t, bishopLookupSize> bishopLookup = generateSliderLookup<false, 0, false>();
+constexpr std::array<uint64_t, bishopLookupSize> bishopPinLookup = generateSliderLookup<false, 1, false>();
+#endif
+
+#ifdef SLIDER_LOOKUP_MAGIC
+constexpr std::array<uint64_t, rookLookupSize> rookMagicLookup = generateSliderLookup<true, 0, true>();
+constexpr std::array<uint64_t, rookLookupSize> rookPinMagicLookup = generateSliderLookup<true, 1, true>();
+constexpr std::array<uint64_t, bishopLookupSize> bishopMagicLookup = generateSliderLookup<false, 0, true>();
+constexpr std::array<uint64_t, bishopLookupSize> bishopPinMagicLookup = generateSliderLookup<false, 1, true>();
+#endif
@@ -0,0 +1,161 @@
+#ifndef KINGOFTHEHILL_KI_MOVEMAPS_H
+#define KINGOFTHEHILL_KI_MOVEMAPS_H
+
+
+#include <array>
+#include <cstdint>
+
+#include "generators.h"
+
+
+/*
+ * Move lookup tables
+ * Every table is generated at compile time from generators.h. The small ones are defined here, so the compiler can
+ * fold lookups with known squares. The slider lookups are too large to be evaluated in every translation unit and are
+ * defined once in moveMaps.cpp instead, still as constant data.
+ */
+
+
+// Slider lookups are indexed by PEXT where the CPU may support it, by magic multiplication where it may not
+#if defined(__x86_64__) || defined(_M_X64)
+#define SLIDER_LOOKUP_PEXT
+#endif
+#if !defined(__BMI2__)
+#define SLIDER_LOOKUP_MAGIC
+#endif
+
+
+template<typename Generator>
+constexpr std::array<uint64_t, 64> generateSquareTable(Generator generator) {
+    std::array<uint64_t, 64> table{};
+    for (int shift = 0; shift < 64; shift++) {
+        table[shift] = generator(shift);
+    }
+    return table;
+}
+
+
+inline constexpr uint64_t aFile = 0x0101010101010101ULL;
+inline constexpr uint64_t bFile = aFile << 1;
+inline constexpr uint64_t cFile = aFile << 2;
+inline constexpr uint64_t dFile = aFile << 3;
+inline constexpr uint64_t eFile = aFile << 4;
+inline constexpr uint64_t fFile = aFile << 5;
+inline constexpr uint64_t gFile = aFile << 6;
+inline constexpr uint64_t hFile = aFile << 7;
+
+inline constexpr uint64_t rank8 = 0xffULL;
+inline constexpr uint64_t rank7 = rank8 << 8;
+inline constexpr uint64_t rank6 = rank8 << 16;
+inline constexpr uint64_t rank5 = rank8 << 24;
+inline constexpr uint64_t rank4 = rank8 << 32;
+inline constexpr uint64_t rank3 = rank8 << 40;
+inline constexpr uint64_t rank2 = rank8 << 48;
+inline constexpr uint64_t rank1 = rank8 << 56;
+
+inline constexpr uint64_t kingOfTheHill = (dFile | eFile) & (rank4 | rank5);
+
+
+inline constexpr std::array<uint64_t, 64> kingMoves = generateSquareTable(generateKingMoves);
+inline constexpr std::array<uint64_t, 64> knightMoves = generateSquareTable(generateKnightMoves);
+
+// Lines through a square, the square itself excluded
+inline constexpr std::array<uint64_t, 64> horizontalMask = generateSquareTable(generateHorizontal);
+inline constexpr std::array<uint64_t, 64> verticalMask = generateSquareTable(generateVertical);
+inline constexpr std::array<uint64_t, 64> lDiagonalMask = generateSquareTable(generateLeftDiagonal);
+inline constexpr std::array<uint64_t, 64> rDiagonalMask = generateSquareTable(generateRightDiagonal);
+
+// xray[64 * a + b]: Squares from b (included) up to a (excluded), e.g. a checking slider and the squares towards the king
+inline constexpr std::array<uint64_t, 64 * 64> xray = [] {
+    std::array<uint64_t, 64 * 64> table{};
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            table[64 * a + b] = generateXray(b, a);
+        }
+    }
+    return table;
+}();
+
+
+// Squares whose occupancy decides a slider lookup
+inline constexpr std::array<uint64_t, 64> rookMoves = generateSquareTable(generateRookMoves);
+inline constexpr std::array<uint64_t, 64> bishopMoves = generateSquareTable(generateBishopMoves);
+
+// Every square has its own block of 2^(squares in its move map) entries, starting at its lookup offset
+constexpr std::array<uint32_t, 65> generateLookupOffsets(const std::array<uint64_t, 64> &moves) {
+    std::array<uint32_t, 65> offsets{};
+    for (int shift = 0; shift < 64; shift++) {
+        offsets[shift + 1] = offsets[shift] + ((uint32_t) 1 << countSquares(moves[shift]));
+    }
+    return offsets;
+}
+
+inline constexpr std::array<uint32_t, 65> rookLookupOffset = generateLookupOffsets(rookMoves);
+inline constexpr std::array<uint32_t, 65> bishopLookupOffset = generateLookupOffsets(bishopMoves);
+
+inline constexpr uint32_t rookLookupSize = rookLookupOffset[64];
+inline constexpr uint32_t bishopLookupSize = bishopLookupOffset[64];
+
+
+// Magic factors for rookMoves/bishopMoves, free of destructive collisions for both the regular and the pin lookups
+inline constexpr std::array<uint64_t, 64> rookMagics = {
+    0x2280001020400080ULL, 0x0140001000200140ULL, 0x2080200010000880ULL, 0x8080080080100004ULL,
+    0x1200108804a00200ULL, 0x8500028100040048ULL, 0x4200080200008144ULL, 0x4080084100102080ULL,
+    0x0080800080204004ULL, 0x8100400040201004ULL, 0x0001004010200100ULL, 0x0042004012000820ULL,
+    0x4491000800110004ULL, 0x0002000200040810ULL, 0x0021006482000900ULL, 0x4886001060820401ULL,
+    0x8220208000804012ULL, 0x0448820020510200ULL, 0x0030002004080020ULL, 0x0100848010000800ULL,
+    0x0001010008001004ULL, 0x6024008002008004ULL, 0x0080040002081001ULL, 0x800a060000408b04ULL,
+    0x2040a1828002c000ULL, 0x0a01004200220080ULL, 0x0400200100104104ULL, 0x0040200900100100ULL,
+    0x1600080080040080ULL, 0x8242008080040002ULL, 0x0046080400021001ULL, 0x010000420005a904ULL,
+    0x0040400020800080ULL, 0x8052401001402000ULL, 0x0003024019002000ULL, 0xa018800800801000ULL,
+    0x2040040080800802ULL, 0x3002800400800200ULL, 0x0002089004000102ULL, 0x1000800060800100ULL,
+    0x00c0804000208001ULL, 0x0010005020084000ULL, 0x0920001008004040ULL, 0x0028100421010008ULL,
+    0x0004000408008080ULL, 0x2100020004008080ULL, 0x0102000104020008ULL, 0x118b00016c810002ULL,
+    0x0410208001005900ULL, 0x2002802001c00680ULL, 0x4010001088200080ULL, 0x4010100280080280ULL,
+    0x8008008008040080ULL, 0x0004000200800480ULL, 0x1850800100020080ULL, 0x1200240100806200ULL,
+    0x0004410091220082ULL, 0x0143400100122a81ULL, 0x200040102001000dULL, 0x0040200410000901ULL,
+    0x1841001002480045ULL, 0x604a004810110c26ULL, 0x0008022081300804ULL, 0x00408414c4810322ULL
+};
+
+inline constexpr std::array<uint64_t, 64> bishopMagics = {
+    0x02416200810b0100ULL, 0x0820c14122028001ULL, 0x0008880102205081ULL, 0x0911040080000a20ULL,
+    0x800110400c928020ULL, 0x0001102630052000ULL, 0x2000880808442002ULL, 0x00042c0104012000ULL,
+    0x2040c11808811040ULL, 0x2000200842008020ULL, 0x2000500488a10200ULL, 0x50032c1403800420ULL,
+    0x0022040420004000ULL, 0x1012a08804404200ULL, 0x0001340114032040ULL, 0x2804008401011010ULL,
+    0x4904001130108100ULL, 0x2044021081020400ULL, 0x0008001000902008ULL, 0x0308000082004000ULL,
+    0x100501c820081084ULL, 0x0004408201100130ULL, 0x8000440098141000ULL, 0x0002000110420201ULL,
+    0x0010044290200208ULL, 0x0904022104100421ULL, 0x000e010508034400ULL, 0x0000802002020200ULL,
+    0x04c1001001004014ULL, 0x6002008088080100ULL, 0x0002088802009000ULL, 0xa4048c8101040488ULL,
+    0x20182090a008220cULL, 0x1044100854ca1a01ULL, 0x0406402200101c00ULL, 0x4108a08020080200ULL,
+    0x8206038401020020ULL, 0x00d0100080011040ULL, 0x0008010400006220ULL, 0x1002040100802880ULL,
+    0x0002021042000401ULL, 0x0208410808042048ULL, 0x4481901888021000ULL, 0x0280002011002800ULL,
+    0x1000280104014040ULL, 0x208801080c202202ULL, 0x1120188210500081ULL, 0x4801040410440082ULL,
+    0x2002021005042822ULL, 0x8001008210020000ULL, 0x0012020201041200ULL, 0x00000004421a0014ULL,
+    0x009040c008221080ULL, 0x8000088208121200ULL, 0x8004042802040804ULL, 0x0030100910409000ULL,
+    0x6002202410080900ULL, 0x440a098414028200ULL, 0x004c180052080400ULL, 0x0022028090208840ULL,
+    0x2000600004a08218ULL, 0x0006001020214100ULL, 0x1000200541480500ULL, 0x1820a802144400a0ULL
+};
+
+inline constexpr std::array<uint64_t, 64> rookMagicShift = generateSquareTable([](int shift) {
+    return (uint64_t) (64 - countSquares(generateRookMoves(shift)));
+});
+inline constexpr std::array<uint64_t, 64> bishopMagicShift = generateSquareTable([](int shift) {
+    return (uint64_t) (64 - countSquares(generateBishopMoves(shift)));
+});
+
+
+// Slider lookups, the pin variants look through the first obstruction, see moveMaps.cpp
+#ifdef SLIDER_LOOKUP_PEXT
+extern const std::array<uint64_t, rookLookupSize> rookLookup;
+extern const std::array<uint64_t, rookLookupSize> rookPinLookup;
+extern const std::array<uint64_t, bishopLookupSize> bishopLookup;
+extern const std::array<uint64_t, bishopLookupSize> bishopPinLookup;
+#endif
+#ifdef SLIDER_LOOKUP_MAGIC
+extern const std::array<uint64_t, rookLookupSize> rookMagicLookup;
+extern const std::array<uint64_t, rookLookupSize> rookPinMagicLookup;
+extern const std::array<uint64_t, bishopLookupSize> bishopMagicLookup;
+extern const std::array<uint64_t, bishopLookupSize> bishopPinMagicLookup;
+#endif
+
+#endif //KINGOFTHEHILL_KI_MOVEMAPS_H
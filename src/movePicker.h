@@ -0,0 +1,254 @@
+#ifndef KINGOFTHEHILL_KI_MOVEPICKER_H
+#define KINGOFTHEHILL_KI_MOVEPICKER_H
+
+
+#include <cstdint>
+#include <cstring>
+
+#include "board.h"
+#include "move.h"
+
+
+/*
+ * Killer moves
+ * Quiet moves that caused a cutoff at the same depth in a sibling node. They are likely to cut off again, so they are
+ * tried right after the captures. Two slots per depth, the newest killer first.
+ */
+
+#define KILLER_MOVES 2
+#define MAX_KILLER_DEPTH 128
+
+typedef struct killerTable {
+    t_move moves[MAX_KILLER_DEPTH][KILLER_MOVES];
+
+    const t_move *at(int depth) const {
+        return depth >= 0 && depth < MAX_KILLER_DEPTH ? moves[depth] : nullptr;
+    }
+
+    void store(int depth, t_move move) {
+        if (depth < 0 || depth >= MAX_KILLER_DEPTH || moves[depth][0] == move) {
+            return;
+        }
+
+        moves[depth][1] = moves[depth][0];
+        moves[depth][0] = move;
+    }
+
+    void clear() {
+        memset(moves, 0, sizeof(moves));
+    }
+} t_killerTable;
+
+
+/*
+ * Staged move picker
+ * Hands out the legal moves of a position one at a time, in the order a cutoff is most likely:
+ * 1. TT move, checked for legality without generating any moves
+ * 2. Winning captures and promotions, most valuable victim / least valuable attacker first
+ * 3. Killer moves
+ * 4. Quiet moves
+ * 5. Losing captures
+ * Captures and quiet moves are generated separately, each when its stage is reached, and captures are only ordered
+ * as far as they are picked. A cutoff on an early move skips most of the generation and ordering work.
+ */
+
+enum class pickerStage {
+    ttMove,
+    generateCaptures,
+    goodCaptures,
+    killers,
+    generateQuiets,
+    quiets,
+    badCaptures,
+    done
+};
+
+// Capture scores at or above this value are winning captures
+#define GOOD_CAPTURE_SCORE 1024
+
+inline const int pickerPieceValue[] = {
+        64,  // King, capturing it ends the game
+        9,   // Queen
+        5,   // Rook
+        3,   // Bishop
+        3,   // Knight
+        1,   // Pawn
+        0    // None
+};
+
+
+template<bool color>
+class MovePicker {
+private:
+    const t_gameState &_state;
+    const t_positionInfo _info;  // Shared by every stage, so the attacks are generated once per node
+    const t_move _ttMove;
+    const t_move *_killers;
+
+    pickerStage _stage = pickerStage::ttMove;
+    bool _ttMovePicked = false;
+    bool _ttMoveRejected = false;
+    bool _killerPicked[KILLER_MOVES] = {};
+
+    MoveList _moves;
+    int _scores[MAX_MOVES];
+    int _captureEnd = 0;  // Captures and promotions come first in _moves, quiet moves are appended after them
+    int _captureIndex = 0;
+    int _killerIndex = 0;
+    int _quietIndex = 0;
+
+    void scoreCaptures() {
+        // Score the generated captures and promotions, losing captures are scored below GOOD_CAPTURE_SCORE
+        const t_board &board = _state.board;
+
+        _captureEnd = _moves.size();
+        for (int i = 0; i < _captureEnd; i++) {
+            t_move mov = _moves[i];
+
+            int victim = mov.flags() == MOVE_FLAG_EN_PASSANT ? pickerPieceValue[(int) piece::pawn]
+                                                             : pickerPieceValue[(int) pieceAt<!color>(board, mov.target())];
+            int attacker = pickerPieceValue[(int) pieceAt<color>(board, mov.origin())];
+            if (mov.isPromotion()) {
+                victim += pickerPieceValue[(int) mov.promotion()] - pickerPieceValue[(int) piece::pawn];
+            }
+
+            bool winning = victim >= attacker;
+            if (!winning) {
+                // Giving up material is fine if the target can't be taken back
+                winning = (_info.threatened & mov.targetMap()) == 0;
+            }
+
+            _scores[i] = (winning ? GOOD_CAPTURE_SCORE : 0) + victim * 16 - attacker;
+        }
+    }
+
+    void selectBestCapture() {
+        // Swap the best remaining capture to _captureIndex
+        int best = _captureIndex;
+        for (int i = _captureIndex + 1; i < _captureEnd; i++) {
+            if (_scores[i] > _scores[best]) {
+                best = i;
+            }
+        }
+
+        t_move bestMove = _moves[best];
+        int bestScore = _scores[best];
+        _moves[best] = _moves[_captureIndex];
+        _scores[best] = _scores[_captureIndex];
+        _moves[_captureIndex] = bestMove;
+        _scores[_captureIndex] = bestScore;
+    }
+
+    bool isPicked(const t_move mov) const {
+        // Whether mov was already handed out by the TT move or killer stage
+        if (_ttMovePicked && mov == _ttMove) {
+            return true;
+        }
+        for (int i = 0; i < KILLER_MOVES; i++) {
+            if (_killerPicked[i] && mov == _killers[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    MovePicker(const t_gameState &state, t_move ttMove, const t_move *killers) :
+            _state(state), _info(getPositionInfo<color>(state.board)), _ttMove(ttMove), _killers(killers) {}
+
+    MovePicker(const MovePicker &other) = delete;
+    MovePicker &operator=(const MovePicker &other) = delete;
+
+    const t_positionInfo &info() const {
+        return _info;
+    }
+
+    bool ttMoveRejected() const {
+        // Whether a TT move was given that doesn't fit the position, known once the first move was picked
+        return _ttMoveRejected;
+    }
+
+    t_move next() {
+        // Next move to search, a null move once all moves were handed out
+        switch (_stage) {
+            case pickerStage::ttMove:
+                _stage = pickerStage::generateCaptures;
+                if (isMoveLegal<color>(_state, _info, _ttMove)) {
+                    _ttMovePicked = true;
+                    return _ttMove;
+                }
+                _ttMoveRejected = !_ttMove.isNull();
+                [[fallthrough]];
+
+            case pickerStage::generateCaptures:
+                generate_moves<color, GenType::Captures>(_state, _info, &_moves);
+                scoreCaptures();
+                _stage = pickerStage::goodCaptures;
+                [[fallthrough]];
+
+            case pickerStage::goodCaptures:
+                while (_captureIndex < _captureEnd) {
+                    selectBestCapture();
+                    if (_scores[_captureIndex] < GOOD_CAPTURE_SCORE) {
+                        break;
+                    }
+
+                    t_move mov = _moves[_captureIndex++];
+                    if (!isPicked(mov)) {
+                        return mov;
+                    }
+                }
+                _stage = pickerStage::killers;
+                [[fallthrough]];
+
+            case pickerStage::killers:
+                // Killers come from other positions, so they have to be checked before they are handed out
+                while (_killers != nullptr && _killerIndex < KILLER_MOVES) {
+                    t_move killer = _killers[_killerIndex];
+                    if (!killer.isCapture() && !killer.isPromotion() && !isPicked(killer) &&
+                        isMoveLegal<color>(_state, _info, killer)) {
+                        _killerPicked[_killerIndex++] = true;
+                        return killer;
+                    }
+                    _killerIndex++;
+                }
+                _stage = pickerStage::generateQuiets;
+                [[fallthrough]];
+
+            case pickerStage::generateQuiets:
+                _quietIndex = _moves.size();
+                generate_moves<color, GenType::Quiets>(_state, _info, &_moves);
+                _stage = pickerStage::quiets;
+                [[fallthrough]];
+
+            case pickerStage::quiets:
+                while (_quietIndex < _moves.size()) {
+                    t_move mov = _moves[_quietIndex++];
+                    if (!isPicked(mov)) {
+                        return mov;
+                    }
+                }
+                _stage = pickerStage::badCaptures;
+                [[fallthrough]];
+
+            case pickerStage::badCaptures:
+                while (_captureIndex < _captureEnd) {
+                    selectBestCapture();
+
+                    t_move mov = _moves[_captureIndex++];
+                    if (!isPicked(mov)) {
+                        return mov;
+                    }
+                }
+                _stage = pickerStage::done;
+                [[fallthrough]];
+
+            case pickerStage::done:
+                return t_move();
+        }
+
+        return t_move();
+    }
+};
+
+#endif //KINGOFTHEHILL_KI_MOVEPICKER_H
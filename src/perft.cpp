@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+#include "board.h"
+#include "move.h"
+#include "game.h"
+
+
+/*
+ * Perft benchmark
+ * Counts the leaf nodes of the legal move tree to a fixed depth, which both verifies generate_moves against known
+ * node counts and measures its throughput. The last ply is bulk-counted, see perft in move.h.
+ *
+ * Usage:
+ *  perft: Run the built-in position suite
+ *  perft <fen> <color> <castleCode> <ep> <depth> [divide]: Run a single position, arguments as for the t_game
+ *      constructor (ep is the en passant file plus one), optionally listing the node count below every root move
+ */
+
+
+typedef struct perftPosition {
+    const char *name;
+    const char *fen;
+    bool color;
+    uint8_t castleCode;
+    uint8_t ep;
+    int depth;
+    uint64_t expected;  // Standard chess node count, the hill does not end the game during perft
+} t_perftPosition;
+
+static const t_perftPosition perftSuite[] = {
+        {"Start position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", false, 0b1111, 0, 5, 4865609},
+        {"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R", false, 0b1111, 0, 4, 4085603},
+        {"Endgame rook and pawns", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8", false, 0b0000, 0, 5, 674624},
+        {"Promotions and checks", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1", false, 0b1100, 0, 4, 422333},
+        {"Underpromotion race", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R", false, 0b0001, 0, 4, 2103487},
+        {"Hill approach", "r1bq1r2/ppp2ppp/2n2k2/8/2B1P3/2N5/PPP2PPP/R2QK2R", false, 0b0001, 0, 4, 1818522},
+        {"Hill pawn endgame", "8/pp3kpp/2p5/8/2K5/5P2/PP4PP/8", true, 0b0000, 0, 5, 634295},
+        {"Hill with heavy pieces", "4r3/8/8/2k5/8/3Q1K2/8/4R3", true, 0b0000, 0, 4, 266668},
+};
+
+
+static void printSquare(uint8_t shift) {
+    Position position = position_from_shift(shift);
+    printf("%c%d", columnToLetter(position.x), position.y + 1);
+}
+
+
+template<bool color>
+static uint64_t perftDivide(t_gameState &state, int depth) {
+    // Perft with the node count below every root move printed separately
+    MoveList moves;
+    generate_moves<color>(state, &moves);
+
+    uint64_t nodes = 0;
+    t_undo undo;
+    for (const t_move mov: moves) {
+        makeMove<color>(state, mov, &undo);
+        uint64_t moveNodes = perft<!color>(state, depth - 1);
+        unmakeMove<color>(state, undo);
+
+        printSquare(mov.origin());
+        printSquare(mov.target());
+        if (mov.isPromotion()) {
+            printf("%c", "nbrq"[mov.flags() & 0b11]);  // Promotion piece in the order of MOVE_PROMOTION_*
+        }
+        printf(": %lu\n", moveNodes);
+
+        nodes += moveNodes;
+    }
+
+    return nodes;
+}
+
+
+static uint64_t runPerft(char *fen, bool color, uint8_t castleCode, uint8_t ep, int depth, bool divide) {
+    // Run perft on a single position and report node count, time and nodes per second
+    t_game game = t_game(fen, color, castleCode, ep, 0);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t nodes;
+    if (divide && depth > 0) {
+        nodes = color ? perftDivide<true>(*game.state, depth) : perftDivide<false>(*game.state, depth);
+    } else {
+        nodes = color ? perft<true>(*game.state, depth) : perft<false>(*game.state, depth);
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double seconds = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1e9;
+
+    printf("Depth %d: %lu nodes [%fs, %.0f nps]\n", depth, nodes, seconds, seconds > 0 ? (double) nodes / seconds : 0);
+
+    // Free memory
+    free(game.state);
+
+    return nodes;
+}
+
+
+static int runSuite() {
+    // Run every suite position and compare against its expected node count
+    int failures = 0;
+    for (const t_perftPosition &position: perftSuite) {
+        printf("%s (%s %s)\n", position.name, position.fen, position.color ? "b" : "w");
+
+        uint64_t nodes = runPerft((char *) position.fen, position.color, position.castleCode, position.ep,
+                                  position.depth, false);
+        if (nodes != position.expected) {
+            printf("MISMATCH: expected %lu nodes\n", position.expected);
+            failures++;
+        }
+    }
+
+    printf("%d of %zu positions mismatched\n", failures, sizeof(perftSuite) / sizeof(perftSuite[0]));
+    return failures == 0 ? 0 : 1;
+}
+
+
+int main(int argc, char **argv) {
+    if (argc == 1) {
+        return runSuite();
+    }
+
+    if (argc != 6 && argc != 7) {
+        fprintf(stderr, "Usage: %s [<fen> <color> <castleCode> <ep> <depth> [divide]]\n", argv[0]);
+        return 2;
+    }
+
+    bool color = atoi(argv[2]) != 0;
+    auto castleCode = (uint8_t) atoi(argv[3]);
+    auto ep = (uint8_t) atoi(argv[4]);
+    int depth = atoi(argv[5]);
+    bool divide = argc == 7 && strcmp(argv[6], "divide") == 0;
+
+    runPerft(argv[1], color, castleCode, ep, depth, divide);
+    return 0;
+}
@@ -2,25 +2,19 @@
 
 #include "scoredMove.h"
 
-scoredMove::scoredMove(float score, t_gameState* move) {
+scoredMove::scoredMove(float score, t_move move) {
     _score = score;
-    _move = static_cast<t_gameState *>(calloc(1, sizeof(t_gameState)));
-    memcpy(_move, move, sizeof(t_gameState));
+    _move = move;
 }
 
-bool scoredMove::operator <(const scoredMove& a){
+bool scoredMove::operator <(const scoredMove& a) const {
     return _score < a._score;
 }
 
-bool scoredMove::operator >(const scoredMove& a){
+bool scoredMove::operator >(const scoredMove& a) const {
     return _score > a._score;
 }
 
-bool scoredMove::operator ==(const scoredMove& a){
+bool scoredMove::operator ==(const scoredMove& a) const {
     return _score == a._score;
 }
-
-scoredMove::~scoredMove() {
-    free(_move);
-}
-
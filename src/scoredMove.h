@@ -10,13 +10,13 @@
 
 class scoredMove{
 public:
-    t_gameState* _move;
+    t_move _move;
     float _score;
-    scoredMove(float score, t_gameState* move);
-    bool operator <(const scoredMove& a);
-    bool operator >(const scoredMove& a);
-    bool operator ==(const scoredMove& a);
-    virtual ~scoredMove();
+    scoredMove() = default;
+    scoredMove(float score, t_move move);
+    bool operator <(const scoredMove& a) const;
+    bool operator >(const scoredMove& a) const;
+    bool operator ==(const scoredMove& a) const;
 };
 
 #endif //KINGOFTHEHILL_KI_SCOREDMOVE_H
@@ -1,193 +1,226 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <new>
+
 #include "transpositionTable.h"
 
-/*t_table* init_table() {
-    t_table* table = (t_table*)calloc(1, sizeof(t_table));
-    table->first = NULL;
-    table->last = NULL;
-    return table;
-}
 
-t_entry* init_entry(uint64_t hash, t_move bestMove, float score, uint8_t vision) {
-    t_entry* newEntry = (t_entry*)calloc(1, sizeof(t_entry));
-    newEntry->hash = hash;
-    newEntry->bestMove = bestMove;
-    newEntry->age = 0;
-    newEntry->vision = vision;
-    newEntry->score = score;
-    newEntry->next = NULL;
-    return newEntry;
+static inline uint16_t keyFragment(uint64_t hash) {
+    // The bucket index is taken from the low bits, the fragment from the high ones
+    return (uint16_t) (hash >> 48);
 }
 
-void add_entry(t_table* table, t_entry* newEntry) {
-    if (table->last == NULL) {
-        table->first = newEntry;
-        table->last = newEntry;
-    }
-    else {
-        table->last->next = newEntry;
-        table->last = newEntry;
-    }
+static inline uint16_t keyCheck(uint64_t data) {
+    // Fold of the data word the key fragment is XORed with, ties the key to the data it was stored with
+    return (uint16_t) (data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
 }
 
-t_entry* get_entry(t_table* table, uint64_t hash) {
-    t_entry* current = table->first;
-    while (current != NULL) {
-        if (current->hash == hash) return current;
-        else current = current->next;
-    }
-    return NULL;
-}
 
-void remove_entry(t_table* table, t_entry* oldEntry) {
-    t_entry* current = table->first;
-    if (current == oldEntry) {
-        table->first = oldEntry->next;
-        if (current == table->last) table->last = oldEntry->next;
-        free(oldEntry);
-        return;
-    }
-    while (current->next != NULL) {
-        if (current->next == oldEntry) {
-            current->next = oldEntry->next;
-            if (oldEntry->next == NULL) {
-                table->last = current;
-                free(oldEntry);
-                return;
-            }
-            free(oldEntry);
-            return;
-        }
-        else {
-            current = current->next;
-        }
-    }
-    throw std::runtime_error("Entry to remove not in table\n");
-}
-
-void age_table(t_table* table) {
-    t_entry* current = table->first;
-    while (current != NULL) {
-        current->age += 1;
-        current = current->next;
-    }
-}
-
-void print_entry(t_entry* entry) {
-    printf("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
-    printf("entry at: %p\n", entry);
-    printf("------------------------------------\n");
-    printf("hash: %" PRIu64 "\n", entry->hash);
-    printf("best Move: ");
-    printMove(entry->bestMove);
-    printf("\n");
-    printf("score: %f\n", entry->score);
-    printf("vision: %i\n", entry->vision);
-    printf("age: %hhu\n", entry->age);
-    printf("next entry at: %p\n", entry->next);
-    printf("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
-}
-
-void print_table(t_table* table) {
-    t_entry* current = table->first;
-    printf("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
-    printf("START OF TABLE at %p\n", current);
-    printf("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
-    while (current != NULL) {
-        print_entry(current);
-        current = current->next;
-    }
-    printf("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
-    printf("END OF TABLE\n");
-    printf("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
-}*/
-
-TableEntry::TableEntry(uint64_t hash, t_move bestMove, float score, uint8_t vision) {
+TableEntry::TableEntry(uint64_t hash, t_move bestMove, float score, uint8_t vision, uint8_t bound) {
     _hash = hash;
-
-    _bestMove = static_cast<t_move *>(calloc(1, sizeof(t_move)));
-    memcpy(_bestMove, &bestMove, sizeof(t_move));
-
-    //_score = static_cast<float *>(calloc(1, sizeof(float)));
-    //memcpy(_score, &score, sizeof(float));
+    _bestMove = bestMove;
     _score = score;
     _vision = vision;
-    //_age = age;
+    _bound = bound;
 }
 
 uint64_t TableEntry::getHash() const {
     return _hash;
 }
 
-void TableEntry::setHash(uint64_t hash) {
-    _hash = hash;
+t_move TableEntry::getBestMove() const {
+    return _bestMove;
 }
 
-const t_move &TableEntry::getBestMove() const {
-    return *_bestMove;
+float TableEntry::getScore() const {
+    return _score;
 }
 
-void TableEntry::setBestMove(const t_move &bestMove) {
-    memcpy(_bestMove, &bestMove, sizeof(t_move));
+uint8_t TableEntry::getVision() const {
+    return _vision;
 }
 
-float TableEntry::getScore() const {
-    return _score;
+uint8_t TableEntry::getBound() const {
+    return _bound;
 }
 
-void TableEntry::setScore(float score) {
-    _score = score;
-    //memcpy(_score, &score, sizeof(float));
+uint8_t TableEntry::getGeneration() const {
+    return _generation;
 }
 
-uint8_t TableEntry::getVision() const {
-    return _vision;
+uint64_t TableEntry::pack(uint8_t generation) const {
+    // Data word of the entry, see transpositionTable.h for the layout
+    return (uint64_t) _bestMove.data
+           | ((uint64_t) std::bit_cast<uint32_t>(_score) << 16)
+           | ((uint64_t) _vision << 48)
+           | ((uint64_t) (_bound & 0b11) << 56)
+           | ((uint64_t) (generation & TT_GENERATION_MASK) << 58);
 }
 
-void TableEntry::setVision(uint8_t vision) {
-    _vision = vision;
+TableEntry TableEntry::unpack(uint64_t hash, uint64_t data) {
+    TableEntry entry;
+    entry._hash = hash;
+    entry._bestMove.data = (uint16_t) data;
+    entry._score = std::bit_cast<float>((uint32_t) (data >> 16));
+    entry._vision = (uint8_t) (data >> 48);
+    entry._bound = (uint8_t) ((data >> 56) & 0b11);
+    entry._generation = (uint8_t) (data >> 58);
+    return entry;
 }
 
-long int TableEntry::getAge() const {
-    return _age;
-}
 
 TranspositionTable::TranspositionTable() {
-    _entryCounter = 0;
+    // Empty table without buckets, every probe misses and nothing is stored until it is resized
+    _buckets = nullptr;
+    _bucketMask = 0;
     _currentAge = 0;
-    _hashTable = new std::map<uint64_t,TableEntry>();
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) : TranspositionTable() {
+    resize(megabytes);
 }
 
 TranspositionTable::~TranspositionTable() {
-    // delete _hashTable;
-};
+    freeLarge(&_memory);
+}
 
+void TranspositionTable::resize(size_t megabytes) {
+    /* Replace the buckets by an empty table of the largest power of two number of buckets fitting into the given size,
+     * at least one. Must not be called while a search uses the table.
+     */
+    size_t bucketCount = std::bit_floor(std::max(megabytes * 1024 * 1024 / sizeof(t_tableBucket), (size_t) 1));
 
+    t_largeAllocation memory = allocateLarge(bucketCount * sizeof(t_tableBucket));
 
-void TranspositionTable::removeEntry(TableEntry entry) {
-    (*_hashTable).erase(entry.getHash());
-    _entryCounter -= 1;
+    freeLarge(&_memory);
+    _memory = memory;
+    _buckets = static_cast<t_tableBucket *>(_memory.memory);
+    _bucketMask = bucketCount - 1;
+
+    // The allocation is left uninitialized, clear constructs the empty buckets
+    clear();
+}
+
+void TranspositionTable::clear() {
+    // Empty every slot and restart the generations, must not be called while a search uses the table
+    if (_buckets != nullptr) {
+        for (size_t i = 0; i <= _bucketMask; i++) {
+            new (&_buckets[i]) t_tableBucket();
+        }
+    }
+    _currentAge = 0;
 }
 
-//return pointer to TableEntry if exists. If not returns NULL
-TableEntry* TranspositionTable::getEntry(uint64_t hash) {
-    if((*_hashTable).find(hash) != (*_hashTable).end()){
-        return &(*_hashTable).find(hash)->second;
-    }else{
-        return nullptr;
+//copy the entry stored for hash into entry. Returns false if there is none
+bool TranspositionTable::getEntry(uint64_t hash, TableEntry *entry) const {
+    if (_buckets == nullptr) {
+        return false;
+    }
+
+    count(&_stats.probes);
+
+    const t_tableBucket &bucket = _buckets[hash & _bucketMask];
+    uint16_t key = keyFragment(hash);
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        uint64_t data = bucket.data[i].load(std::memory_order_relaxed);
+        uint16_t storedKey = bucket.keys[i].load(std::memory_order_relaxed);
+        if (data != 0 && (storedKey ^ keyCheck(data)) == key) {
+            *entry = TableEntry::unpack(hash, data);
+
+            count(&_stats.hits);
+            count(entry->getBound() == TT_BOUND_EXACT ? &_stats.exactHits : &_stats.boundHits);
+            return true;
+        }
     }
+    return false;
 }
 
-void TranspositionTable::setEntry(TableEntry te) {
-    if((*_hashTable).find(te.getHash()) == (*_hashTable).end()) {
-        (*_hashTable).insert(std::pair<uint64_t, TableEntry>(te.getHash(), te));
-        _entryCounter++;
-    }else {
-        (*_hashTable).find(te.getHash())->second = te;
+int TranspositionTable::replacementValue(uint64_t data) const {
+    // How valuable a stored entry is worth keeping: Deep and exact entries of the current search are kept the longest
+    TableEntry entry = TableEntry::unpack(0, data);
+    int age = (_currentAge - entry.getGeneration()) & TT_GENERATION_MASK;
+    return entry.getVision() + (entry.getBound() == TT_BOUND_EXACT ? TT_REPLACE_EXACT_BONUS : 0) - age * TT_REPLACE_AGE_WEIGHT;
+}
+
+void TranspositionTable::setEntry(const TableEntry &te) {
+    /* Store te, replacing the entry of the same position or an empty slot if there is one, else the least valuable entry
+     * of the bucket (see replacementValue). An entry of the same position from the current search is only replaced by an
+     * exact or a not much shallower result.
+     */
+    if (_buckets == nullptr) {
+        return;
+    }
+
+    t_tableBucket &bucket = _buckets[te.getHash() & _bucketMask];
+    uint16_t key = keyFragment(te.getHash());
+
+    // Other threads may write the bucket meanwhile, every slot is read once and decided on that copy
+    int slot = 0;
+    uint64_t slotData = 0;
+    int slotValue = 0;
+    bool samePosition = false;
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        uint64_t data = bucket.data[i].load(std::memory_order_relaxed);
+        uint16_t storedKey = bucket.keys[i].load(std::memory_order_relaxed);
+        if (data == 0 || (storedKey ^ keyCheck(data)) == key) {
+            slot = i;
+            slotData = data;
+            samePosition = data != 0;
+            break;
+        }
+
+        int value = replacementValue(data);
+        if (i == 0 || value < slotValue) {
+            slot = i;
+            slotData = data;
+            slotValue = value;
+        }
+    }
+
+    if (samePosition) {
+        TableEntry stored = TableEntry::unpack(te.getHash(), slotData);
+        if (stored.getGeneration() == (_currentAge & TT_GENERATION_MASK) && te.getBound() != TT_BOUND_EXACT
+            && te.getVision() + TT_REPLACE_DEPTH_MARGIN < stored.getVision()) {
+            count(&_stats.storesRefused);
+            return;
+        }
+    }
+
+    count(&_stats.stores);
+    count(samePosition ? &_stats.storesSamePosition : slotData == 0 ? &_stats.storesEmpty : &_stats.storesEvicted);
+
+    uint64_t data = te.pack((uint8_t) _currentAge);
+    if (samePosition && te.getBestMove().isNull()) {
+        // Keep the best move found for the position before
+        data = (data & ~(uint64_t) 0xffff) | (slotData & 0xffff);
     }
+
+    bucket.data[slot].store(data, std::memory_order_relaxed);
+    bucket.keys[slot].store(key ^ keyCheck(data), std::memory_order_relaxed);
 }
 
 int TranspositionTable::getSize() const {
-    return (int )_entryCounter;
+    // Number of occupied slots, counted over the whole table
+    if (_buckets == nullptr) {
+        return 0;
+    }
+
+    int size = 0;
+    for (size_t i = 0; i <= _bucketMask; i++) {
+        for (const std::atomic<uint64_t> &data: _buckets[i].data) {
+            size += data.load(std::memory_order_relaxed) != 0;
+        }
+    }
+    return size;
+}
+
+size_t TranspositionTable::getBucketCount() const {
+    return _buckets == nullptr ? 0 : _bucketMask + 1;
+}
+
+const t_largeAllocation &TranspositionTable::getMemory() const {
+    return _memory;
 }
 
 long int TranspositionTable::getAge() const {
@@ -195,12 +228,47 @@ long int TranspositionTable::getAge() const {
 }
 
 void TranspositionTable::setAge(long int age) {
-    _currentAge = (int )age;
+    _currentAge = (int )(age & TT_GENERATION_MASK);
 }
 
 void TranspositionTable::ageingTable(){
-    _currentAge++;
+    // Start a new search generation, entries of earlier ones become the first to be replaced
+    _currentAge = (_currentAge + 1) & TT_GENERATION_MASK;
+}
+
+int TranspositionTable::hashfull() const {
+    // Permille of the slots holding an entry of the current search, sampled over the first slots of the table
+    if (_buckets == nullptr) {
+        return 0;
+    }
+
+    size_t sampleBuckets = std::min(_bucketMask + 1, (size_t) (1000 + TT_BUCKET_ENTRIES - 1) / TT_BUCKET_ENTRIES);
+
+    int current = 0;
+    for (size_t i = 0; i < sampleBuckets; i++) {
+        for (const std::atomic<uint64_t> &slot: _buckets[i].data) {
+            uint64_t data = slot.load(std::memory_order_relaxed);
+            current += data != 0 && TableEntry::unpack(0, data).getGeneration() == (_currentAge & TT_GENERATION_MASK);
+        }
+    }
+    return (int) (current * 1000 / (sampleBuckets * TT_BUCKET_ENTRIES));
 }
 
+const t_tableStats &TranspositionTable::getStats() const {
+    // Only consistent while no search uses the table
+    return _stats;
+}
 
+void TranspositionTable::resetStats() {
+    _stats = t_tableStats();
+}
 
+void TranspositionTable::printStats() const {
+    const t_tableStats &stats = _stats;
+    double hitRate = stats.probes > 0 ? 100.0 * (double) stats.hits / (double) stats.probes : 0;
+
+    printf("Table: %lu probes, %lu hits (%.1f%%, %lu exact, %lu bounds), %lu cutoffs, %lu collisions, hashfull %d\n",
+           stats.probes, stats.hits, hitRate, stats.exactHits, stats.boundHits, stats.cutoffs, stats.collisions, hashfull());
+    printf("Table: %lu stores (%lu empty, %lu same position, %lu evicted), %lu refused\n",
+           stats.stores, stats.storesEmpty, stats.storesSamePosition, stats.storesEvicted, stats.storesRefused);
+}
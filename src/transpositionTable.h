@@ -1,74 +1,163 @@
 #ifndef KINGOFTHEHILL_KI_TRANSPOSITIONTABLE_H
 #define KINGOFTHEHILL_KI_TRANSPOSITIONTABLE_H
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <map>
 
+#include "largePages.h"
 #include "move.h"
 
 
 /*
-typedef struct tableentry {
-    uint64_t hash;
-    t_move bestMove;
-    float score;
-    uint8_t vision; // how deep the search was from this position
-    uint8_t age;
-    tableentry* next;
-}t_entry;
-
-typedef struct table {
-    t_entry* first;
-    t_entry* last;
-}t_table;
-
-t_table* init_table();
-void print_entry(t_entry* entry);
-void print_table(t_table* table);
-t_entry* init_entry(uint64_t hash, t_move bestMove, float score, uint8_t vision);
-void add_entry(t_table* table, t_entry* newEntry);
-t_entry* get_entry(t_table* table, uint64_t hash);
-void remove_entry(t_table* table, t_entry* oldEntry);
-void age_table(t_table* table);*/
+ * Transposition table
+ * A power of two number of 64 byte buckets, each filling one cache line, so a probe costs at most one cache miss. The
+ * low bits of the hash select the bucket, the top 16 bits are kept as key fragment to tell the entries of a bucket
+ * apart. An entry is packed into one data word:
+ *  bits  0-15: Best move
+ *  bits 16-47: Score (float)
+ *  bits 48-55: Vision, how deep the search below the position went
+ *  bits 56-57: Bound of the score, see TT_BOUND_*
+ *  bits 58-63: Generation of the search that stored it
+ * Stored entries always have a bound, so a zero data word marks an empty slot.
+ *
+ * One table serves both colors, the hash tells the side to move apart. It is owned by whoever drives the search (see
+ * playAlphaBeta) and handed to it, games don't carry tables of their own.
+ *
+ * The buckets are allocated on huge pages where available (see largePages.h), a table of hundreds of megabytes would
+ * otherwise miss the TLB on nearly every probe.
+ *
+ * A table may be probed and written by any number of threads without locks.
+ * Data words and key fragments are separate relaxed atomics, the key fragment is stored XORed with a fold of the data
+ * word. A slot read while another thread writes it pairs the key of one entry with the data of another and fails the
+ * key check, so a torn entry is as unlikely to be used as a 16 bit key collision.
+ *
+ * The table counts its probes, hits, stores and collisions, see getStats. The counters use relaxed loads and
+ * stores, exact while one thread searches, which is all the search does so far. Threads sharing a table may lose
+ * counts.
+ */
+
+#define TT_DEFAULT_SIZE_MB 32
+
+#define TT_BUCKET_ENTRIES 6
+
+#define TT_BOUND_LOWER 0b01  // Search failed high, the score is a lower bound
+#define TT_BOUND_UPPER 0b10  // Search failed low, the score is an upper bound
+#define TT_BOUND_EXACT 0b11
+
+#define TT_GENERATION_MASK 0b111111
+
+// Replacement, see TranspositionTable::setEntry
+#define TT_REPLACE_AGE_WEIGHT 8  // Vision an entry is worth less per generation it is old
+#define TT_REPLACE_EXACT_BONUS 2  // Vision an exact entry is worth more than a bound
+#define TT_REPLACE_DEPTH_MARGIN 3  // Vision a bound may lack to replace an entry of the same position and search
+
+
+typedef struct alignas(64) tableBucket {
+    std::atomic<uint64_t> data[TT_BUCKET_ENTRIES];
+    std::atomic<uint16_t> keys[TT_BUCKET_ENTRIES];  // Key fragment XOR keyCheck(data)
+} t_tableBucket;
+
+static_assert(sizeof(t_tableBucket) == 64, "A bucket must fill exactly one cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint16_t>::is_always_lock_free,
+              "Transposition table slots must be lock free");
+
+
+typedef struct tableStats {
+    // Counters since the last resetStats, see TranspositionTable::printStats
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t exactHits = 0;
+    uint64_t boundHits = 0;
+    uint64_t cutoffs = 0;  // Hits that decided the position without searching it
+    uint64_t stores = 0;
+    uint64_t storesEmpty = 0;  // Into an empty slot
+    uint64_t storesSamePosition = 0;  // Over an entry of the same position
+    uint64_t storesEvicted = 0;  // Over the least valuable entry of a full bucket
+    uint64_t storesRefused = 0;  // Dropped to keep a deeper entry of the same position
+    uint64_t collisions = 0;  // Hits whose best move doesn't fit the position, so they belong to another one
+} t_tableStats;
 
 
 class TableEntry{
 public:
-    TableEntry(uint64_t hash, t_move bestMove, float score, uint8_t vision);
+    TableEntry() = default;
+    TableEntry(uint64_t hash, t_move bestMove, float score, uint8_t vision, uint8_t bound);
     uint64_t getHash() const;
-    void setHash(uint64_t hash);
-    const t_move &getBestMove() const;
-    void setBestMove(const t_move &bestMove);
+    t_move getBestMove() const;
     float getScore() const;
-    void setScore(float score);
     uint8_t getVision() const;
-    void setVision(uint8_t vision);
-    long int getAge() const;
+    uint8_t getBound() const;
+    uint8_t getGeneration() const;
+
+    uint64_t pack(uint8_t generation) const;
+    static TableEntry unpack(uint64_t hash, uint64_t data);
 
 private:
-    uint64_t _hash;
-    t_move *_bestMove;
-    float _score;
-    uint8_t _vision;
-    long int _age;
+    uint64_t _hash = 0;
+    t_move _bestMove = t_move();
+    float _score = 0;
+    uint8_t _vision = 0;
+    uint8_t _bound = 0;
+    uint8_t _generation = 0;
 };
 
 class TranspositionTable{
 public:
     TranspositionTable();
+    explicit TranspositionTable(size_t megabytes);
     ~TranspositionTable();
-    void print_entry(TableEntry entry);
-    void removeEntry(TableEntry entry);
-    TableEntry* getEntry(uint64_t hash);
-    void setEntry(TableEntry te);
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+    void resize(size_t megabytes);
+    void clear();
+    void prefetch(uint64_t hash) const;
+    bool getEntry(uint64_t hash, TableEntry *entry) const;
+    void setEntry(const TableEntry &te);
     int getSize() const;
+    size_t getBucketCount() const;
+    const t_largeAllocation &getMemory() const;
     long int getAge() const;
     void setAge(long int age);
     void ageingTable();
-    std::map<uint64_t,TableEntry>* _hashTable;
+    int hashfull() const;
+    void recordCutoff();
+    void recordCollision();
+    const t_tableStats &getStats() const;
+    void resetStats();
+    void printStats() const;
 private:
-    long int _entryCounter;
+    int replacementValue(uint64_t data) const;
+    static void count(uint64_t *counter);
+
+    t_largeAllocation _memory;
+    t_tableBucket *_buckets;
+    size_t _bucketMask;
     int _currentAge;
+
+    mutable t_tableStats _stats;
 };
 
-#endif //KINGOFTHEHILL_KI_TRANSPOSITIONTABLE_H
\ No newline at end of file
+
+inline void TranspositionTable::prefetch(uint64_t hash) const {
+    // Start loading the bucket of hash into the cache, for a getEntry or setEntry shortly after
+#if defined(__GNUC__)
+    __builtin_prefetch(_buckets + (hash & _bucketMask));
+#endif
+}
+
+inline void TranspositionTable::count(uint64_t *counter) {
+    // Relaxed load and store instead of an atomic increment: Free of data races, but without a locked instruction
+    std::atomic_ref<uint64_t> value(*counter);
+    value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline void TranspositionTable::recordCutoff() {
+    count(&_stats.cutoffs);
+}
+
+inline void TranspositionTable::recordCollision() {
+    count(&_stats.collisions);
+}
+
+#endif //KINGOFTHEHILL_KI_TRANSPOSITIONTABLE_H
@@ -1,4 +1,5 @@
 #include <stdexcept>
+#include <time.h>
 
 #include "util.h"
 
@@ -232,17 +233,6 @@ float min(float num1, float num2) {
 }
 
 
-int countFigure(uint64_t singleBoard) {
-    int count = 0;
-    for (int i = 0; i < 64; i++) {
-        if (singleBoard & ((uint64_t) 1 << i)) {
-            count++;
-        }
-    }
-    return count;
-}
-
-
 int randn(int start, int stop) {
     // Initialize rng
     timespec ts{};
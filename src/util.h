@@ -7,6 +7,8 @@
 #include <stdexcept>
 #include <cstring>
 
+#include "bits.h"
+
 #define field uint64_t
 
 
@@ -67,7 +69,6 @@ template <typename I> std::string num2hex(I w, size_t hex_len = sizeof(I)<<1) {
     return rc;
 }
 
-int countFigure(field singleBoard);
 int randn(int start, int stop);
 
 #endif
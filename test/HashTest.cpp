@@ -0,0 +1,88 @@
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "game.h"
+#include "hash.h"
+
+class HashTest : public ::testing::Test {
+
+protected:
+    static bool playRandomMove(t_game *game, std::mt19937 *rng) {
+        MoveList moves;
+        if (game->turn) {
+            generate_moves<true>(*game->state, &moves);
+        } else {
+            generate_moves<false>(*game->state, &moves);
+        }
+        if (moves.empty()) {
+            return false;
+        }
+
+        game->commitMove(moves[(int) ((*rng)() % (uint32_t) moves.size())]);
+        return true;
+    }
+
+    long checks = 0;
+    long mismatches = 0;
+
+    char kiwipeteFen[60] = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R";
+};
+
+
+TEST_F(HashTest, incrementalHashMatchesFullHash) {
+    // Random games from two positions with castles, checked after every move and every take back
+    std::mt19937 rng(0x4b6f7448);
+
+    t_game start(0);
+    t_game kiwipete(kiwipeteFen, false, 0b1111, 0, 0);
+
+    for (int i = 0; i < 200; i++) {
+        // Every game is taken back completely, so the two games are reused
+        t_game &game = i % 2 == 0 ? start : kiwipete;
+
+        std::vector<uint64_t> hashes = {game.state->hash};
+        for (int ply = 0; ply < 150 && playRandomMove(&game, &rng); ply++) {
+            checks++;
+            mismatches += game.state->hash != hash(game.state, game.turn);
+            hashes.push_back(game.state->hash);
+        }
+
+        while (!game.undoStack.empty()) {
+            game.revertMove();
+            hashes.pop_back();
+
+            checks++;
+            mismatches += game.state->hash != hash(game.state, game.turn) || game.state->hash != hashes.back();
+        }
+    }
+
+    EXPECT_GT(checks, 10000);
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST_F(HashTest, transpositionsHashEqual) {
+    // 1. Nf3 Nf6 2. Nc3 and 1. Nc3 Nf6 2. Nf3 reach the same position
+    t_game first(0);
+    first.commitMove(t_move(62, 45, MOVE_FLAG_QUIET));
+    first.commitMove(t_move(6, 21, MOVE_FLAG_QUIET));
+    first.commitMove(t_move(57, 42, MOVE_FLAG_QUIET));
+
+    t_game second(0);
+    second.commitMove(t_move(57, 42, MOVE_FLAG_QUIET));
+    second.commitMove(t_move(6, 21, MOVE_FLAG_QUIET));
+    second.commitMove(t_move(62, 45, MOVE_FLAG_QUIET));
+
+    EXPECT_EQ(first.state->hash, second.state->hash);
+}
+
+TEST_F(HashTest, stateBesidesBoardChangesHash) {
+    t_game white(kiwipeteFen, false, 0b1111, 0, 0);
+    t_game black(kiwipeteFen, true, 0b1111, 0, 0);
+    t_game noCastles(kiwipeteFen, false, 0, 0, 0);
+    t_game enPassant(kiwipeteFen, false, 0b1111, 3, 0);
+
+    EXPECT_NE(white.state->hash, black.state->hash);
+    EXPECT_NE(white.state->hash, noCastles.state->hash);
+    EXPECT_NE(white.state->hash, enPassant.state->hash);
+}
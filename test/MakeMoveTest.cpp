@@ -0,0 +1,150 @@
+#include "gtest/gtest.h"
+
+#include "game.h"
+#include "move.h"
+
+class MakeMoveTest : public ::testing::Test {
+
+protected:
+    static bool sameState(const t_gameState &a, const t_gameState &b) {
+        const t_board &x = a.board;
+        const t_board &y = b.board;
+        return x.whiteKing == y.whiteKing && x.whiteQueen == y.whiteQueen && x.whiteRook == y.whiteRook &&
+               x.whiteBishop == y.whiteBishop && x.whiteKnight == y.whiteKnight && x.whitePawn == y.whitePawn &&
+               x.blackKing == y.blackKing && x.blackQueen == y.blackQueen && x.blackRook == y.blackRook &&
+               x.blackBishop == y.blackBishop && x.blackKnight == y.blackKnight && x.blackPawn == y.blackPawn &&
+               x.white == y.white && x.black == y.black && x.occupied == y.occupied &&
+               memcmp(x.pieceOn, y.pieceOn, sizeof(x.pieceOn)) == 0 &&
+               a.move == b.move && a.enpassant == b.enpassant &&
+               a.wCastleShort == b.wCastleShort && a.wCastleLong == b.wCastleLong &&
+               a.bCastleShort == b.bCastleShort && a.bCastleLong == b.bCastleLong && a.hash == b.hash;
+    }
+
+    static bool mailboxMatchesBitboards(const t_board &board) {
+        // The board constructor builds the mailbox from the bitboards alone
+        t_board rebuilt(board.whiteKing, board.whiteQueen, board.whiteRook, board.whiteBishop, board.whiteKnight,
+                        board.whitePawn, board.blackKing, board.blackQueen, board.blackRook, board.blackBishop,
+                        board.blackKnight, board.blackPawn);
+        return memcmp(rebuilt.pieceOn, board.pieceOn, sizeof(board.pieceOn)) == 0 &&
+               rebuilt.white == board.white && rebuilt.black == board.black && rebuilt.occupied == board.occupied;
+    }
+
+    template<bool color>
+    void walk(t_gameState &state, int depth) {
+        // Make and unmake every move down to depth, counting positions that don't match what they should be
+        checks++;
+        mismatches += !mailboxMatchesBitboards(state.board);
+        if (depth == 0) {
+            return;
+        }
+
+        MoveList moves;
+        generate_moves<color>(state, &moves);
+        for (t_move mov: moves) {
+            t_gameState before = state;
+            t_undo undo;
+
+            makeMove<color>(state, mov, &undo);
+            checks++;
+            mismatches += state.move != mov || state.hash != hash(&state, !color);
+
+            walk<!color>(state, depth - 1);
+            unmakeMove<color>(state, undo);
+
+            checks++;
+            mismatches += !sameState(state, before);
+        }
+    }
+
+    long checks = 0;
+    long mismatches = 0;
+
+    char kiwipeteFen[60] = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R";
+    char promotionsFen[60] = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1";
+    char enPassantFen[60] = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8";
+};
+
+
+TEST_F(MakeMoveTest, unmakeRestoresEveryPosition) {
+    // Castles, promotions, en passant and captures of every piece, three plies deep
+    t_game kiwipete(kiwipeteFen, false, 0b1111, 0, 0);
+    walk<false>(*kiwipete.state, 3);
+
+    t_game promotions(promotionsFen, false, 0b1100, 0, 0);
+    walk<false>(*promotions.state, 3);
+
+    t_game enPassant(enPassantFen, false, 0, 0, 0);
+    walk<false>(*enPassant.state, 4);
+
+    EXPECT_GT(checks, 100000);
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST_F(MakeMoveTest, revertRestoresGame) {
+    // Taking back through the game restores the state and passes the turn back
+    t_game game(kiwipeteFen, false, 0b1111, 0, 0);
+    t_gameState before = *game.state;
+
+    game.commitMove(t_move(60, 62, MOVE_FLAG_CASTLE_SHORT));
+    EXPECT_TRUE(game.turn);
+    EXPECT_FALSE(game.state->wCastleShort);
+
+    game.revertMove();
+    EXPECT_FALSE(game.turn);
+    EXPECT_TRUE(sameState(*game.state, before));
+}
+
+TEST_F(MakeMoveTest, movesPackIntoSixteenBits) {
+    t_move mov(52, 36, MOVE_FLAG_DOUBLE_PUSH);
+    EXPECT_EQ(sizeof(t_move), 2);
+    EXPECT_EQ(mov.origin(), 52);
+    EXPECT_EQ(mov.target(), 36);
+    EXPECT_EQ(mov.flags(), MOVE_FLAG_DOUBLE_PUSH);
+    EXPECT_FALSE(mov.isCapture());
+
+    t_move promotion(9, 0, MOVE_FLAG_PROMOTION | MOVE_FLAG_CAPTURE | MOVE_PROMOTION_KNIGHT);
+    EXPECT_TRUE(promotion.isCapture());
+    EXPECT_TRUE(promotion.isPromotion());
+    EXPECT_EQ(promotion.promotion(), piece::knight);
+
+    EXPECT_TRUE(t_move().isNull());
+}
+
+TEST_F(MakeMoveTest, whitePromotionKeepsKnights) {
+    t_game game((char *) "4k3/P7/8/8/8/8/8/1N2K3", false, 0, 0, 0);
+    uint64_t knights = game.board().whiteKnight;
+
+    game.commitMove(t_move(8, 0, MOVE_FLAG_PROMOTION | MOVE_PROMOTION_QUEEN));
+
+    EXPECT_EQ(game.board().whiteKnight, knights);
+    EXPECT_EQ(game.board().whiteQueen, (uint64_t) 1 << 0);
+    EXPECT_EQ(game.board().whitePawn, (uint64_t) 0);
+    EXPECT_TRUE(mailboxMatchesBitboards(game.board()));
+}
+
+TEST_F(MakeMoveTest, enPassantKeepsCastleRights) {
+    // Only black may castle long, an en passant by black must not change that
+    t_game game((char *) "r3k3/8/8/8/3p4/8/4P3/4K3", false, 0b1000, 0, 0);
+
+    game.commitMove(t_move(52, 36, MOVE_FLAG_DOUBLE_PUSH));
+    game.commitMove(t_move(35, 44, MOVE_FLAG_EN_PASSANT));
+
+    EXPECT_EQ(game.board().whitePawn, (uint64_t) 0);
+    EXPECT_EQ(game.board().blackPawn, (uint64_t) 1 << 44);
+    EXPECT_TRUE(game.state->bCastleLong);
+    EXPECT_FALSE(game.state->wCastleLong);
+}
+
+TEST_F(MakeMoveTest, rookMoveKeepsLostCastleRights) {
+    // White may only castle short, moving the other rook must not bring back the long castle
+    t_game game((char *) "4k3/8/8/8/8/8/8/1R2K2R", false, 0b0001, 0, 0);
+
+    game.commitMove(t_move(57, 49, MOVE_FLAG_QUIET));
+    EXPECT_TRUE(game.state->wCastleShort);
+    EXPECT_FALSE(game.state->wCastleLong);
+
+    game.revertMove();
+    game.commitMove(t_move(63, 55, MOVE_FLAG_QUIET));
+    EXPECT_FALSE(game.state->wCastleShort);
+    EXPECT_FALSE(game.state->wCastleLong);
+}
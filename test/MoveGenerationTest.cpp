@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "game.h"
+#include "move.h"
+
+class MoveGenerationTest : public ::testing::Test {
+
+protected:
+    template<bool color, GenType type>
+    static std::vector<uint16_t> generated(const t_gameState &state) {
+        // Sorted data words of the generated moves, so lists compare as multisets
+        MoveList moves;
+        generate_moves<color, type>(state, &moves);
+
+        std::vector<uint16_t> result;
+        for (t_move mov: moves) {
+            result.push_back(mov.data);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    template<bool color>
+    void checkVariants(t_gameState &state, int depth) {
+        // Compare the variants against All in state and every position below it, counting the ones that differ
+        std::vector<uint16_t> all = generated<color, GenType::All>(state);
+        std::vector<uint16_t> captures = generated<color, GenType::Captures>(state);
+        std::vector<uint16_t> quiets = generated<color, GenType::Quiets>(state);
+        std::vector<uint16_t> evasions = generated<color, GenType::Evasions>(state);
+
+        std::vector<uint16_t> merged;
+        std::merge(captures.begin(), captures.end(), quiets.begin(), quiets.end(), std::back_inserter(merged));
+
+        MoveList captureMoves;
+        generate_moves<color, GenType::Captures>(state, &captureMoves);
+        bool capturesOnly = std::all_of(captureMoves.begin(), captureMoves.end(), [](t_move mov) {
+            return mov.isCapture() || mov.isPromotion();
+        });
+        const t_board &board = state.board;
+        bool inCheck = (color ? board.blackKing & getThreatenedBlack(board) : board.whiteKing & getThreatenedWhite(board)) != 0;
+
+        checks++;
+        mismatches += merged != all || !capturesOnly || evasions != (inCheck ? all : std::vector<uint16_t>());
+        checkedInCheck += inCheck;
+        if (depth == 0) {
+            return;
+        }
+
+        MoveList moves;
+        generate_moves<color>(state, &moves);
+        for (t_move mov: moves) {
+            t_undo undo;
+            makeMove<color>(state, mov, &undo);
+            checkVariants<!color>(state, depth - 1);
+            unmakeMove<color>(state, undo);
+        }
+    }
+
+    long checks = 0;
+    long checkedInCheck = 0;
+    long mismatches = 0;
+
+    char kiwipeteFen[60] = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R";
+    char promotionsFen[60] = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1";
+    char enPassantFen[60] = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8";
+};
+
+
+TEST_F(MoveGenerationTest, variantsSplitAllMoves) {
+    // Captures and quiets partition all moves, evasions are all moves in check and none otherwise
+    t_game kiwipete(kiwipeteFen, false, 0b1111, 0, 0);
+    checkVariants<false>(*kiwipete.state, 3);
+
+    t_game promotions(promotionsFen, false, 0b1100, 0, 0);
+    checkVariants<false>(*promotions.state, 3);
+
+    t_game enPassant(enPassantFen, false, 0, 0, 0);
+    checkVariants<false>(*enPassant.state, 4);
+
+    EXPECT_GT(checks, 100000);
+    EXPECT_GT(checkedInCheck, 1000);
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST_F(MoveGenerationTest, evasionsOfDoubleCheckAreKingMoves) {
+    // Rook on e8 and bishop on b4 both check the king on e1, the knight can't help and only the king may move
+    t_game game((char *) "4r2k/8/8/8/1b6/8/8/N3K3", false, 0, 0, 0);
+
+    std::vector<uint16_t> evasions = generated<false, GenType::Evasions>(*game.state);
+    std::vector<uint16_t> expected = {t_move(60, 59, MOVE_FLAG_QUIET).data, t_move(60, 61, MOVE_FLAG_QUIET).data,
+                                      t_move(60, 53, MOVE_FLAG_QUIET).data};
+    std::sort(expected.begin(), expected.end());
+
+    EXPECT_EQ(evasions, expected);
+    EXPECT_EQ(evasions, (generated<false, GenType::All>(*game.state)));
+}
+
+TEST_F(MoveGenerationTest, hillThreatsAreKingMovesTowardsHill) {
+    // From e2 only the steps onto the third rank reach the hill or its neighbourhood
+    t_game below((char *) "7k/8/8/8/8/8/4K3/8", false, 0, 0, 0);
+    std::vector<uint16_t> expected = {t_move(52, 43, MOVE_FLAG_QUIET).data, t_move(52, 44, MOVE_FLAG_QUIET).data,
+                                      t_move(52, 45, MOVE_FLAG_QUIET).data};
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ((generated<false, GenType::HillThreats>(*below.state)), expected);
+
+    // Guarded squares are left out, enemy pieces on the others are taken
+    t_game guarded((char *) "7k/8/8/8/8/4n3/4K3/3r4", false, 0, 0, 0);
+    expected = {t_move(52, 44, MOVE_FLAG_CAPTURE).data, t_move(52, 45, MOVE_FLAG_QUIET).data};
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ((generated<false, GenType::HillThreats>(*guarded.state)), expected);
+
+    // A king on the hill stays within the neighbourhood with every step, black's hill is the same
+    t_game onHill((char *) "8/8/8/3k4/8/8/8/K7", true, 0, 0, 0);
+    EXPECT_EQ((generated<true, GenType::HillThreats>(*onHill.state)), (generated<true, GenType::All>(*onHill.state)));
+    EXPECT_EQ((generated<true, GenType::HillThreats>(*onHill.state)).size(), 8);
+
+    // Far from the hill there is nothing to threaten
+    t_game far((char *) "7k/8/8/8/8/8/8/K7", false, 0, 0, 0);
+    EXPECT_TRUE((generated<false, GenType::HillThreats>(*far.state)).empty());
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "game.h"
+#include "move.h"
+#include "movePicker.h"
+
+class MovePickerTest : public ::testing::Test {
+
+protected:
+    template<bool color>
+    static std::vector<t_move> drain(const t_gameState &state, t_move ttMove, const t_move *killers) {
+        // Every move the picker hands out, in order
+        MovePicker<color> picker(state, ttMove, killers);
+
+        std::vector<t_move> picked;
+        for (t_move mov = picker.next(); !mov.isNull(); mov = picker.next()) {
+            picked.push_back(mov);
+        }
+        return picked;
+    }
+
+    static std::vector<uint16_t> sorted(const std::vector<t_move> &moves) {
+        std::vector<uint16_t> result;
+        for (t_move mov: moves) {
+            result.push_back(mov.data);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    template<bool color>
+    void checkPicker(t_gameState &state, int depth) {
+        /* Drain the picker in state and every position below it, with no hints, with a legal TT move and killers taken
+         * from the position itself, and with a TT move and killers left by the positions visited before, which may or
+         * may not fit. Counts the drains that don't return exactly the generated moves.
+         */
+        MoveList moves;
+        generate_moves<color>(state, &moves);
+        std::vector<t_move> all(moves.begin(), moves.end());
+        std::vector<uint16_t> expected = sorted(all);
+
+        checks++;
+        mismatches += sorted(drain<color>(state, t_move(), nullptr)) != expected;
+
+        if (!all.empty()) {
+            t_move ttMove = all[(checks * 7) % all.size()];
+            t_move killers[KILLER_MOVES] = {ttMove, all[(checks * 13) % all.size()]};
+
+            std::vector<t_move> picked = drain<color>(state, ttMove, killers);
+            checks++;
+            mismatches += sorted(picked) != expected || picked.front() != ttMove;
+        }
+
+        checks++;
+        mismatches += sorted(drain<color>(state, foreignTtMove, foreignKillers.at(0))) != expected;
+        if (!all.empty()) {
+            foreignTtMove = all.front();
+            foreignKillers.store(0, all.back());
+        }
+
+        if (depth == 0) {
+            return;
+        }
+        for (t_move mov: all) {
+            t_undo undo;
+            makeMove<color>(state, mov, &undo);
+            checkPicker<!color>(state, depth - 1);
+            unmakeMove<color>(state, undo);
+        }
+    }
+
+    long checks = 0;
+    long mismatches = 0;
+
+    t_move foreignTtMove = t_move();
+    t_killerTable foreignKillers = {};
+
+    char kiwipeteFen[60] = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R";
+    char promotionsFen[60] = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1";
+};
+
+
+TEST_F(MovePickerTest, picksEveryLegalMoveOnce) {
+    t_game kiwipete(kiwipeteFen, false, 0b1111, 0, 0);
+    checkPicker<false>(*kiwipete.state, 2);
+
+    t_game promotions(promotionsFen, false, 0b1100, 0, 0);
+    checkPicker<false>(*promotions.state, 2);
+
+    t_game start(0);
+    checkPicker<false>(*start.state, 3);
+
+    EXPECT_GT(checks, 10000);
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST_F(MovePickerTest, stagesComeInOrder) {
+    // The queen wins the loose rook on a4, but loses itself for the pawn on d5, which e6 protects
+    t_game game((char *) "4k3/8/4p3/3p4/r7/8/8/3QK3", false, 0, 0, 0);
+    t_move ttMove(60, 53, MOVE_FLAG_QUIET);
+    t_move killers[KILLER_MOVES] = {ttMove, t_move(60, 61, MOVE_FLAG_QUIET)};
+
+    std::vector<t_move> picked = drain<false>(*game.state, ttMove, killers);
+
+    ASSERT_GE(picked.size(), 4);
+    EXPECT_EQ(picked[0], ttMove);
+    EXPECT_EQ(picked[1], t_move(59, 32, MOVE_FLAG_CAPTURE));
+    EXPECT_EQ(picked[2], killers[1]);
+    EXPECT_EQ(picked.back(), t_move(59, 27, MOVE_FLAG_CAPTURE));
+    for (size_t i = 3; i + 1 < picked.size(); i++) {
+        EXPECT_FALSE(picked[i].isCapture());
+    }
+
+    MoveList moves;
+    generate_moves<false>(*game.state, &moves);
+    EXPECT_EQ(sorted(picked), sorted(std::vector<t_move>(moves.begin(), moves.end())));
+}
+
+TEST_F(MovePickerTest, movesNotFittingThePositionAreRejected) {
+    t_game game(0);
+
+    // Nothing stands on a6, and a capture killer is left to the capture stages
+    t_move killers[KILLER_MOVES] = {t_move(52, 44, MOVE_FLAG_CAPTURE), t_move(52, 36, MOVE_FLAG_DOUBLE_PUSH)};
+    MovePicker<false> picker(*game.state, t_move(16, 24, MOVE_FLAG_QUIET), killers);
+
+    EXPECT_EQ(picker.next(), killers[1]);
+
+    int count = 1;
+    while (!picker.next().isNull()) {
+        count++;
+    }
+    EXPECT_EQ(count, 20);
+    EXPECT_TRUE(picker.next().isNull());
+}
@@ -0,0 +1,56 @@
+#include <chrono>
+
+#include "gtest/gtest.h"
+
+#include "game.h"
+#include "hikaru.h"
+
+class SearchTest : public ::testing::Test {
+
+protected:
+    virtual void SetUp()
+    {
+        table.resize(16);
+    }
+
+    TranspositionTable table;
+
+    // Wide enough that no search gets far within a fraction of a second
+    char kiwipeteFen[60] = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R";
+};
+
+
+TEST_F(SearchTest, searchEndsByHardDeadline) {
+    // Two seconds for 40 moves leave a hard deadline of 125ms, see searchTimes
+    t_game game(kiwipeteFen, false, 0b1111, 0, 2);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    t_searchLimits limits = searchTimes<false>(&game);
+    std::pair<t_move, float> result = iterativeDeepening<false>(&game, &table, 100, &limits);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    EXPECT_GE(limits.completedDepth, 1);
+    EXPECT_FALSE(result.first.isNull());
+
+    // The clock is only read every SEARCH_CLOCK_INTERVAL nodes, which takes well below the tolerance
+    EXPECT_LE(end, limits.hardDeadline + std::chrono::milliseconds(20));
+    EXPECT_LE(end, start + std::chrono::milliseconds(125 + 20));
+}
+
+TEST_F(SearchTest, moveIsFromLastCompletedIteration) {
+    t_game game(kiwipeteFen, false, 0b1111, 0, 2);
+    t_searchLimits limits = searchTimes<false>(&game);
+    std::pair<t_move, float> result = iterativeDeepening<false>(&game, &table, 100, &limits);
+    ASSERT_GE(limits.completedDepth, 1);
+
+    // Searching just the completed iterations again, on a fresh game and table and without deadlines, repeats them
+    // step by step, whatever the abandoned or skipped iteration after them did
+    t_game fresh(kiwipeteFen, false, 0b1111, 0, 2);
+    TranspositionTable freshTable(16);
+    t_searchLimits unlimited;
+    std::pair<t_move, float> expected = iterativeDeepening<false>(&fresh, &freshTable, limits.completedDepth, &unlimited);
+
+    EXPECT_EQ(unlimited.completedDepth, limits.completedDepth);
+    EXPECT_EQ(result.first, expected.first);
+    EXPECT_EQ(result.second, expected.second);
+}
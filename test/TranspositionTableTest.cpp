@@ -0,0 +1,327 @@
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hikaru.h"
+#include "transpositionTable.h"
+
+class TranspositionTableTest : public ::testing::Test {
+
+protected:
+    virtual void SetUp()
+    {
+        table.resize(1);
+    }
+
+    uint64_t sameBucket(uint16_t key) const {
+        // Hash of another position in the bucket of position, told apart by the key fragment in the top bits only
+        return (position & ~((uint64_t) 0xffff << 48)) | ((uint64_t) key << 48);
+    }
+
+    static t_move someMove(uint8_t origin) {
+        return t_move(origin, origin + 8, MOVE_FLAG_QUIET);
+    }
+
+    TableEntry derivedEntry(uint16_t key) const {
+        // Entry of the position with the given key fragment, every field follows from the key
+        uint64_t mixed = key * 0x9e3779b97f4a7c15ULL;
+        return TableEntry(sameBucket(key), t_move(1 + mixed % 63, (mixed >> 6) % 64, MOVE_FLAG_QUIET),
+                          (float) (mixed >> 40), (uint8_t) (mixed >> 20), TT_BOUND_EXACT);
+    }
+
+    TranspositionTable table;
+    uint64_t position = 0x9e3779b97f4a7c15ULL;
+};
+
+
+TEST_F(TranspositionTableTest, packedEntryRoundTrips) {
+    const t_move moves[] = {t_move(), someMove(12),
+                            t_move(63, 0, MOVE_FLAG_PROMOTION | MOVE_PROMOTION_QUEEN | MOVE_FLAG_CAPTURE)};
+    const float scores[] = {0.0f, -0.0f, 1.5f, -1234.25f,
+                            std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+    const uint8_t visions[] = {0, 1, 100, 255};
+    const uint8_t bounds[] = {TT_BOUND_LOWER, TT_BOUND_UPPER, TT_BOUND_EXACT};
+    const uint8_t generations[] = {0, 1, 42, TT_GENERATION_MASK};
+
+    for (t_move mov: moves) {
+        for (float score: scores) {
+            for (uint8_t vision: visions) {
+                for (uint8_t bound: bounds) {
+                    for (uint8_t generation: generations) {
+                        uint64_t data = TableEntry(position, mov, score, vision, bound).pack(generation);
+                        TableEntry entry = TableEntry::unpack(position, data);
+
+                        // A stored entry always has a bound, so its data word never looks like an empty slot
+                        EXPECT_NE(data, (uint64_t) 0);
+                        EXPECT_EQ(entry.getHash(), position);
+                        EXPECT_EQ(entry.getBestMove(), mov);
+                        EXPECT_EQ(std::bit_cast<uint32_t>(entry.getScore()), std::bit_cast<uint32_t>(score));
+                        EXPECT_EQ(entry.getVision(), vision);
+                        EXPECT_EQ(entry.getBound(), bound);
+                        EXPECT_EQ(entry.getGeneration(), generation);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(TranspositionTableTest, generationsWrap) {
+    // Generations only have six bits, the age after the last one starts over
+    table.setAge(TT_GENERATION_MASK);
+    table.ageingTable();
+    EXPECT_EQ(table.getAge(), 0);
+
+    // An entry of the search before the wrap is still one generation old, so it is replaced by a shallow one
+    table.setAge(TT_GENERATION_MASK);
+    table.setEntry(TableEntry(position, someMove(1), 2.0f, 10, TT_BOUND_LOWER));
+    table.ageingTable();
+    table.setEntry(TableEntry(position, someMove(2), 3.0f, 1, TT_BOUND_UPPER));
+
+    TableEntry entry;
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getVision(), 1);
+    EXPECT_EQ(entry.getGeneration(), 0);
+}
+
+TEST_F(TranspositionTableTest, storedEntryIsFound) {
+    TableEntry entry;
+    EXPECT_FALSE(table.getEntry(position, &entry));
+
+    table.setEntry(TableEntry(position, someMove(12), 1.5f, 4, TT_BOUND_EXACT));
+
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getBestMove(), someMove(12));
+    EXPECT_EQ(entry.getScore(), 1.5f);
+    EXPECT_EQ(entry.getVision(), 4);
+    EXPECT_EQ(entry.getBound(), TT_BOUND_EXACT);
+
+    // Same bucket, but another key fragment
+    EXPECT_FALSE(table.getEntry(sameBucket(0x1234), &entry));
+}
+
+TEST_F(TranspositionTableTest, fullBucketEvictsShallowestEntry) {
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        table.setEntry(TableEntry(sameBucket(i + 1), someMove(i), 0, (uint8_t) (i + 2), TT_BOUND_LOWER));
+    }
+
+    table.setEntry(TableEntry(sameBucket(100), someMove(20), 0, 3, TT_BOUND_LOWER));
+
+    TableEntry entry;
+    EXPECT_FALSE(table.getEntry(sameBucket(1), &entry));
+    for (int i = 1; i < TT_BUCKET_ENTRIES; i++) {
+        EXPECT_TRUE(table.getEntry(sameBucket(i + 1), &entry));
+    }
+    EXPECT_TRUE(table.getEntry(sameBucket(100), &entry));
+}
+
+TEST_F(TranspositionTableTest, entriesOfEarlierSearchesAreEvictedFirst) {
+    // A deep entry of the previous search is worth less than the shallow ones of the current search
+    table.setEntry(TableEntry(sameBucket(1), someMove(0), 0, 8, TT_BOUND_LOWER));
+    table.ageingTable();
+    for (int i = 1; i < TT_BUCKET_ENTRIES; i++) {
+        table.setEntry(TableEntry(sameBucket(i + 1), someMove(i), 0, 2, TT_BOUND_LOWER));
+    }
+
+    table.setEntry(TableEntry(sameBucket(100), someMove(20), 0, 1, TT_BOUND_LOWER));
+
+    TableEntry entry;
+    EXPECT_FALSE(table.getEntry(sameBucket(1), &entry));
+    EXPECT_TRUE(table.getEntry(sameBucket(2), &entry));
+    EXPECT_TRUE(table.getEntry(sameBucket(100), &entry));
+}
+
+TEST_F(TranspositionTableTest, samePositionKeepsDeeperEntry) {
+    TableEntry entry;
+    table.setEntry(TableEntry(position, someMove(1), 2.0f, 10, TT_BOUND_LOWER));
+
+    // Much shallower bound of the same search: Refused
+    table.setEntry(TableEntry(position, someMove(2), 3.0f, 10 - TT_REPLACE_DEPTH_MARGIN - 1, TT_BOUND_UPPER));
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getVision(), 10);
+    EXPECT_EQ(entry.getBestMove(), someMove(1));
+
+    // Bound within the margin: Replaces
+    table.setEntry(TableEntry(position, someMove(3), 3.0f, 10 - TT_REPLACE_DEPTH_MARGIN, TT_BOUND_UPPER));
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getVision(), 10 - TT_REPLACE_DEPTH_MARGIN);
+    EXPECT_EQ(entry.getBestMove(), someMove(3));
+
+    // Exact scores always replace
+    table.setEntry(TableEntry(position, someMove(4), 1.0f, 1, TT_BOUND_EXACT));
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getVision(), 1);
+    EXPECT_EQ(entry.getBound(), TT_BOUND_EXACT);
+
+    // Without a best move, the one stored before is kept
+    table.setEntry(TableEntry(position, t_move(), 1.0f, 2, TT_BOUND_EXACT));
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getVision(), 2);
+    EXPECT_EQ(entry.getBestMove(), someMove(4));
+}
+
+TEST_F(TranspositionTableTest, samePositionOfEarlierSearchIsReplaced) {
+    table.setEntry(TableEntry(position, someMove(1), 2.0f, 10, TT_BOUND_LOWER));
+    table.ageingTable();
+
+    table.setEntry(TableEntry(position, someMove(2), 3.0f, 1, TT_BOUND_UPPER));
+
+    TableEntry entry;
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getVision(), 1);
+    EXPECT_EQ(entry.getBound(), TT_BOUND_UPPER);
+}
+
+TEST_F(TranspositionTableTest, clearEmptiesTable) {
+    table.setEntry(TableEntry(position, someMove(1), 2.0f, 10, TT_BOUND_EXACT));
+    EXPECT_EQ(table.getSize(), 1);
+
+    table.clear();
+
+    TableEntry entry;
+    EXPECT_FALSE(table.getEntry(position, &entry));
+    EXPECT_EQ(table.getSize(), 0);
+}
+
+TEST_F(TranspositionTableTest, statsCountProbesAndStores) {
+    TableEntry entry;
+    table.getEntry(position, &entry);
+    table.setEntry(TableEntry(position, someMove(1), 2.0f, 10, TT_BOUND_LOWER));
+    table.getEntry(position, &entry);
+
+    // Too shallow to replace the bound of the same search
+    table.setEntry(TableEntry(position, someMove(2), 2.0f, 1, TT_BOUND_UPPER));
+    table.setEntry(TableEntry(position, someMove(3), 2.0f, 12, TT_BOUND_EXACT));
+    table.getEntry(position, &entry);
+    table.recordCutoff();
+
+    const t_tableStats &stats = table.getStats();
+    EXPECT_EQ(stats.probes, 3);
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.exactHits, 1);
+    EXPECT_EQ(stats.boundHits, 1);
+    EXPECT_EQ(stats.cutoffs, 1);
+    EXPECT_EQ(stats.stores, 2);
+    EXPECT_EQ(stats.storesEmpty, 1);
+    EXPECT_EQ(stats.storesSamePosition, 1);
+    EXPECT_EQ(stats.storesRefused, 1);
+
+    table.resetStats();
+    EXPECT_EQ(table.getStats().probes, 0);
+}
+
+TEST_F(TranspositionTableTest, tableWithoutBucketsStoresNothing) {
+    TranspositionTable empty;
+    empty.setEntry(TableEntry(position, someMove(1), 2.0f, 10, TT_BOUND_EXACT));
+
+    TableEntry entry;
+    EXPECT_FALSE(empty.getEntry(position, &entry));
+    EXPECT_EQ(empty.getSize(), 0);
+    EXPECT_EQ(empty.getBucketCount(), 0);
+    EXPECT_EQ(table.getBucketCount(), 1024 * 1024 / sizeof(t_tableBucket));
+}
+
+TEST_F(TranspositionTableTest, concurrentStoresNeverMixEntries) {
+    /* Four threads store and probe eight positions sharing one bucket. A probe combining the key of one store with
+     * the data of another would return fields that don't follow from the key. Races are only as likely as the machine
+     * running the test has cores to interleave them.
+     */
+    std::atomic<long> hits = 0;
+    std::atomic<long> mismatches = 0;
+
+    auto work = [&](int thread) {
+        std::mt19937 rng(thread);
+        for (int i = 0; i < 1000000; i++) {
+            TableEntry expected = derivedEntry((uint16_t) (1 + rng() % 8));
+            if (rng() % 2 == 0) {
+                table.setEntry(expected);
+                continue;
+            }
+
+            TableEntry entry;
+            if (table.getEntry(expected.getHash(), &entry)) {
+                hits++;
+                mismatches += entry.getBestMove() != expected.getBestMove() || entry.getScore() != expected.getScore() ||
+                              entry.getVision() != expected.getVision() || entry.getBound() != expected.getBound();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back(work, i);
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    EXPECT_GT(hits, 10000);
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST_F(TranspositionTableTest, shallowEntriesNeverCutOff) {
+    float alpha = -100, beta = 100;
+    EXPECT_FALSE(probeCutoff(TableEntry(position, t_move(), 1.0f, 3, TT_BOUND_EXACT), 4, &alpha, &beta));
+    EXPECT_EQ(alpha, -100);
+    EXPECT_EQ(beta, 100);
+}
+
+TEST_F(TranspositionTableTest, boundsNarrowTheWindow) {
+    float alpha = -100, beta = 100;
+    EXPECT_TRUE(probeCutoff(TableEntry(position, t_move(), 1.0f, 4, TT_BOUND_EXACT), 4, &alpha, &beta));
+
+    // A lower bound raises alpha, and decides the position once it reaches beta
+    alpha = -100, beta = 100;
+    EXPECT_FALSE(probeCutoff(TableEntry(position, t_move(), 5.0f, 4, TT_BOUND_LOWER), 4, &alpha, &beta));
+    EXPECT_EQ(alpha, 5.0f);
+    EXPECT_EQ(beta, 100);
+    alpha = -100, beta = 3;
+    EXPECT_TRUE(probeCutoff(TableEntry(position, t_move(), 5.0f, 4, TT_BOUND_LOWER), 4, &alpha, &beta));
+
+    // An upper bound lowers beta, and decides the position once it reaches alpha
+    alpha = -100, beta = 100;
+    EXPECT_FALSE(probeCutoff(TableEntry(position, t_move(), -5.0f, 6, TT_BOUND_UPPER), 4, &alpha, &beta));
+    EXPECT_EQ(alpha, -100);
+    EXPECT_EQ(beta, -5.0f);
+    alpha = -3, beta = 100;
+    EXPECT_TRUE(probeCutoff(TableEntry(position, t_move(), -5.0f, 6, TT_BOUND_UPPER), 4, &alpha, &beta));
+}
+
+TEST_F(TranspositionTableTest, storedBoundFollowsWindow) {
+    TableEntry entry;
+
+    storeResult<false>(&table, position, someMove(1), 0.5f, 4, -1, 1);
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getBound(), TT_BOUND_EXACT);
+
+    // White failing low found no move reaching alpha, so none is stored as best
+    table.clear();
+    storeResult<false>(&table, position, someMove(1), -1, 4, -1, 1);
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getBound(), TT_BOUND_UPPER);
+    EXPECT_TRUE(entry.getBestMove().isNull());
+
+    table.clear();
+    storeResult<false>(&table, position, someMove(1), 1, 4, -1, 1);
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getBound(), TT_BOUND_LOWER);
+    EXPECT_EQ(entry.getBestMove(), someMove(1));
+
+    // For black, minimizing, failing high is what finds no move
+    table.clear();
+    storeResult<true>(&table, position, someMove(1), 1, 4, -1, 1);
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getBound(), TT_BOUND_LOWER);
+    EXPECT_TRUE(entry.getBestMove().isNull());
+
+    table.clear();
+    storeResult<true>(&table, position, someMove(1), -1, 4, -1, 1);
+    ASSERT_TRUE(table.getEntry(position, &entry));
+    EXPECT_EQ(entry.getBound(), TT_BOUND_UPPER);
+    EXPECT_EQ(entry.getBestMove(), someMove(1));
+}